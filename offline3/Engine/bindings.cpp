@@ -1,10 +1,52 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include "board.hpp"
 #include "player.hpp"
+#include "search_task.hpp"
 
 namespace py = pybind11;
 
+using byte_array = py::array_t<uint8_t, py::array::c_style | py::array::forcecast>;
+
+// Views straight into the board's storage; `self` is kept alive as the base.
+// They are read-only because writes would bypass the Zobrist hash.
+py::array board_view(py::object self, py::dtype dtype, const void *data)
+{
+    Board &board = self.cast<Board &>();
+    py::array view(dtype, {board.get_rows(), board.get_cols()}, {board.get_cols(), 1}, data, self);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+Board board_from_arrays(byte_array counts, py::array owners)
+{
+    // 'S1' arrays (b'R', b'B', b' ') are read as their bytes
+    if (owners.dtype().kind() == 'S' && owners.dtype().itemsize() == 1)
+        owners = owners.attr("view")("uint8");
+    byte_array owner_bytes = byte_array::ensure(owners);
+    if (!owner_bytes || counts.ndim() != 2 || owner_bytes.ndim() != 2 ||
+        counts.shape(0) != owner_bytes.shape(0) || counts.shape(1) != owner_bytes.shape(1))
+        throw py::value_error("counts and owners must be 2-D arrays of the same shape");
+    int rows = counts.shape(0), cols = counts.shape(1);
+    if (rows < 2 || cols < 2 || (long long)rows * cols > MAX_BOARD_CELLS)
+        throw py::value_error("board must be at least 2x2 and at most " + to_string(MAX_BOARD_CELLS) + " cells");
+    // anything a game could not reach would break the hash keys and wave lanes
+    const uint8_t *count = counts.data();
+    const char *owner = (const char *)owner_bytes.data();
+    for (int i = 0; i < rows * cols; i++)
+    {
+        int r = i / cols, c = i % cols;
+        if (owner[i] != 'R' && owner[i] != 'B' && owner[i] != ' ' && owner[i] != 0)
+            throw py::value_error("owner at (" + to_string(r) + ", " + to_string(c) + ") must be 'R', 'B', ' ' or empty");
+        if (count[i] > 0 && (owner[i] == ' ' || owner[i] == 0))
+            throw py::value_error("empty cell at (" + to_string(r) + ", " + to_string(c) + ") has orbs");
+        if (count[i] >= critical_mass(r, c, rows, cols))
+            throw py::value_error("count at (" + to_string(r) + ", " + to_string(c) + ") reaches critical mass");
+    }
+    return Board(rows, cols, count, owner);
+}
+
 PYBIND11_MODULE(Chain_reaction, m) {
     // Cell class
     py::class_<Cell>(m, "Cell")
@@ -18,8 +60,14 @@ PYBIND11_MODULE(Chain_reaction, m) {
     // Board class
     py::class_<Board>(m, "Board")
         .def(py::init<int, int>())
-        .def("insert_orb", &Board::insert_orb, py::arg("row"), py::arg("col"), py::arg("color"), py::arg("force") = false)
-        .def("get_valid_moves", &Board::get_valid_moves)
+        .def(py::init(&board_from_arrays), py::arg("counts"), py::arg("owners"))
+        .def_property_readonly("counts", [](py::object self)
+                               { return board_view(self, py::dtype::of<uint8_t>(), self.cast<Board &>().get_counts()); })
+        .def_property_readonly("owners", [](py::object self)
+                               { return board_view(self, py::dtype("S1"), self.cast<Board &>().get_owners()); })
+        .def("insert_orb", &Board::insert_orb, py::arg("row"), py::arg("col"), py::arg("color"))
+        .def("set_cell", &Board::set_cell, py::arg("row"), py::arg("col"), py::arg("count"), py::arg("color"))
+        .def("get_valid_moves", static_cast<vector<pair<int, int>> (Board::*)(char) const>(&Board::get_valid_moves))
         .def("get_score", &Board::get_score)
         .def("is_game_over", &Board::is_game_over)
         .def("get_orb_count", &Board::get_orb_count)
@@ -28,6 +76,29 @@ PYBIND11_MODULE(Chain_reaction, m) {
         .def("get_cols", &Board::get_cols)
         .def("get_critical_mass", &Board::get_critical_mass);
 
+    // Evaluators for AI.set_evaluator
+    py::class_<Evaluator, shared_ptr<Evaluator>>(m, "Evaluator")
+        .def("evaluate", &Evaluator::evaluate, py::arg("board"), py::arg("color"));
+    py::class_<OrbEvaluator, Evaluator, shared_ptr<OrbEvaluator>>(m, "OrbEvaluator")
+        .def(py::init<>());
+    py::class_<FeatureEvaluator::Weights>(m, "FeatureWeights")
+        .def(py::init<>())
+        .def_readwrite("orbs", &FeatureEvaluator::Weights::orbs)
+        .def_readwrite("critical", &FeatureEvaluator::Weights::critical)
+        .def_readwrite("corners", &FeatureEvaluator::Weights::corners)
+        .def_readwrite("edges", &FeatureEvaluator::Weights::edges)
+        .def_readwrite("vulnerable", &FeatureEvaluator::Weights::vulnerable)
+        .def_readwrite("chains", &FeatureEvaluator::Weights::chains);
+    py::class_<FeatureEvaluator, Evaluator, shared_ptr<FeatureEvaluator>>(m, "FeatureEvaluator")
+        .def(py::init<>())
+        .def(py::init<const FeatureEvaluator::Weights &>(), py::arg("weights"))
+        .def_readonly("weights", &FeatureEvaluator::weights);
+
+    // Opening book file written by book_gen, memory-mapped
+    py::class_<OpeningBook, shared_ptr<OpeningBook>>(m, "OpeningBook")
+        .def(py::init<const string &>(), py::arg("path"))
+        .def("size", &OpeningBook::size);
+
     // Human player
     py::class_<Human>(m, "Human")
         .def(py::init<char>())
@@ -35,6 +106,39 @@ PYBIND11_MODULE(Chain_reaction, m) {
 
     // AI player
     py::class_<AI>(m, "AI")
-        .def(py::init<char, int>())
-        .def("make_move", &AI::make_move, py::arg("board"), py::arg("row") = 0, py::arg("col") = 0);
-}
+        .def(py::init<char, int, int>(), py::arg("color"), py::arg("depth") = 4, py::arg("time_limit_ms") = 0)
+        .def("make_move", &AI::make_move, py::arg("board"), py::arg("row") = 0, py::arg("col") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("search_async", [](AI &ai, const Board &board, int budget_ms)
+             { return unique_ptr<SearchTask>(new SearchTask(ai, board, budget_ms)); },
+             py::arg("board"), py::arg("budget_ms") = 0, py::keep_alive<0, 1>())
+        .def("set_time_limit", &AI::set_time_limit)
+        .def("set_threads", &AI::set_threads)
+        .def("set_deterministic", &AI::set_deterministic)
+        .def("set_quiescence", &AI::set_quiescence)
+        .def("set_endgame", &AI::set_endgame)
+        .def("set_book", [](AI &ai, shared_ptr<OpeningBook> book)
+             { ai.set_book(book); })
+        .def("set_evaluator", [](AI &ai, shared_ptr<Evaluator> e)
+             { ai.set_evaluator(e); })
+        .def("get_nodes", &AI::get_nodes)
+        .def("get_completed_depth", &AI::get_completed_depth)
+        .def("get_last_move", &AI::get_last_move);
+
+    // Handle returned by AI.search_async; the search runs without the GIL
+    py::class_<SearchTask>(m, "SearchTask")
+        .def("done", &SearchTask::done)
+        .def("cancel", &SearchTask::cancel)
+        .def("best_move", &SearchTask::best_move)
+        .def("depth", &SearchTask::depth)
+        .def("wait", &SearchTask::wait, py::call_guard<py::gil_scoped_release>());
+
+    // Monte Carlo tree search player
+    py::class_<MCTS>(m, "MCTS")
+        .def(py::init<char, int, int, int>(), py::arg("color"), py::arg("playouts") = 10000, py::arg("time_limit_ms") = 0, py::arg("threads") = 1)
+        .def("make_move", &MCTS::make_move, py::arg("board"), py::arg("row") = 0, py::arg("col") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_playouts", &MCTS::get_playouts)
+        .def("get_tree_size", &MCTS::get_tree_size)
+        .def("get_last_move", &MCTS::get_last_move);
+}
\ No newline at end of file
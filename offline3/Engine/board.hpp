@@ -4,8 +4,111 @@
 #include <vector>
 #include <queue>
 #include <set>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 using namespace std;
 
+// Zobrist keys per (cell, color, orb count). A cell that reaches critical
+// mass is emptied at once, so counts stay at 3 or below; the fifth key per
+// cell and color is unused but keeps the keys, and so book files, as they
+// were. Boards with more than MAX_ZOBRIST_CELLS cells reuse keys, which
+// only costs hash quality.
+const int MAX_ZOBRIST_CELLS = 1024;
+
+// Widest board the wave kernel packs into one 64-bit word per row.
+const int WAVE_MAX_COLS = 16;
+
+// Largest board: neighbour indices are int16_t.
+const int MAX_BOARD_CELLS = INT16_MAX;
+
+inline const vector<uint64_t> &zobrist_table()
+{
+    static const vector<uint64_t> table = []
+    {
+        vector<uint64_t> keys(MAX_ZOBRIST_CELLS * 2 * 5);
+        uint64_t x = 0;
+        for (auto &key : keys)
+        {
+            // splitmix64
+            x += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            key = z ^ (z >> 31);
+        }
+        return keys;
+    }();
+    return table;
+}
+
+// empty cells hash to 0
+inline uint64_t zobrist_key(int index, char color, int count)
+{
+    if (count == 0)
+        return 0;
+    return zobrist_table()[((index % MAX_ZOBRIST_CELLS) * 2 + (color == 'R' ? 0 : 1)) * 5 + count];
+}
+
+inline constexpr int critical_mass(int row, int col, int rows, int cols)
+{
+    return 4 - (row == 0 || row == rows - 1) - (col == 0 || col == cols - 1);
+}
+
+// Fills the per-cell tables of a rows x cols board: critical mass, and the
+// neighbours of cell i at neighbors[4 * i ...] in the order up, right,
+// down, left, with -1 after the last one.
+inline void fill_geometry(int rows, int cols, uint8_t *capacity, int16_t *neighbors)
+{
+    for (int row = 0; row < rows; row++)
+        for (int col = 0; col < cols; col++)
+        {
+            int index = row * cols + col;
+            capacity[index] = critical_mass(row, col, rows, cols);
+            int count = 0;
+            if (row > 0)
+                neighbors[4 * index + count++] = index - cols;
+            if (col < cols - 1)
+                neighbors[4 * index + count++] = index + 1;
+            if (row < rows - 1)
+                neighbors[4 * index + count++] = index + cols;
+            if (col > 0)
+                neighbors[4 * index + count++] = index - 1;
+            while (count < 4)
+                neighbors[4 * index + count++] = -1;
+        }
+}
+
+struct Geometry
+{
+    const uint8_t *capacity;
+    const int16_t *neighbors;
+};
+
+// Built once per board size and shared by every board of that size.
+struct DynamicGeometry
+{
+    vector<uint8_t> capacity;
+    vector<int16_t> neighbors;
+};
+
+inline Geometry find_geometry(int rows, int cols)
+{
+    static mutex cache_mutex;
+    static map<pair<int, int>, unique_ptr<DynamicGeometry>> cache;
+    lock_guard<mutex> lock(cache_mutex);
+    auto &entry = cache[{rows, cols}];
+    if (!entry)
+    {
+        entry.reset(new DynamicGeometry());
+        entry->capacity.resize(rows * cols);
+        entry->neighbors.resize(rows * cols * 4);
+        fill_geometry(rows, cols, entry->capacity.data(), entry->neighbors.data());
+    }
+    return {entry->capacity.data(), entry->neighbors.data()};
+}
+
 class Cell
 {
     int orb_count;
@@ -24,23 +127,176 @@ public:
     void set_color(char col) { color = col; }
 };
 
+// Evaluation terms kept current by every cell write, so reading them is
+// O(1). Indexed by side: 0 for red, 1 for blue.
+struct Features
+{
+    int orbs[2];
+    int cells[2];
+    int critical[2];   // cells one orb short of exploding
+    int corners[2];    // owned corner cells
+    int edges[2];      // owned edge cells, corners excluded
+    int vulnerable[2]; // own cells next to a critical enemy cell, counted per such neighbour
+    int chains[2];     // adjacent pairs of own critical cells
+};
+
 class Board
 {
+    // A cell as it was before a move overwrote it.
+    struct Change
+    {
+        int index;
+        int orb_count;
+        char color;
+    };
+
     int rows, cols;
-    vector<vector<Cell>> grid;
+    // Row-major and contiguous so Python can view them without copying.
+    vector<uint8_t> counts; // orbs per cell
+    vector<char> owners;    // owner color per cell, ' ' when empty
+    const uint8_t *capacity;  // critical mass per cell, from find_geometry
+    const int16_t *neighbors; // four slots per cell, see fill_geometry
+    Features features;
+    vector<Change> undo_log;
+    vector<int> move_starts; // undo_log size when each applied move started
+    vector<int> explosion_queue;
+    uint64_t hash;
+
+    // Wave kernel state: one word per row, 4 bits per cell (see explode_waves).
+    uint64_t lane_capacity[2]; // critical mass per lane for outer rows, inner rows
+    uint64_t row_lanes;        // lanes in use
+    vector<uint64_t> wave_counts, wave_critical, wave_touched, wave_enemy;
+
+    static int side(char color) { return color == 'R' ? 0 : 1; }
+
+    bool is_critical(int index) const { return counts[index] + 1 == capacity[index]; }
+
+    // What a cell holding `count` orbs of `color` adds to the features on
+    // its own (sign 1), or removes again (sign -1).
+    void count_cell(int index, char color, int count, int sign)
+    {
+        if (color == ' ')
+            return;
+        int me = side(color);
+        features.orbs[me] += sign * count;
+        features.cells[me] += sign;
+        features.critical[me] += sign * (count + 1 == capacity[index]);
+        features.corners[me] += sign * (capacity[index] == 2);
+        features.edges[me] += sign * (capacity[index] == 3);
+    }
+
+    // What the pair (cell, neighbor) adds to the features while the cell
+    // holds `color` and is critical or not.
+    void count_pair(int neighbor, char color, bool critical, int sign)
+    {
+        if (color == ' ' || owners[neighbor] == ' ')
+            return;
+        int me = side(color);
+        bool neighbor_critical = is_critical(neighbor);
+        if (owners[neighbor] == color)
+            features.chains[me] += sign * (critical && neighbor_critical);
+        else
+        {
+            features.vulnerable[me] += sign * neighbor_critical;
+            features.vulnerable[1 - me] += sign * critical;
+        }
+    }
+
+    // Every cell write goes through here to keep the Zobrist hash and the
+    // features current.
+    void write_cell(int index, int count, char color)
+    {
+        char old_color = owners[index];
+        int old_count = counts[index];
+        hash ^= zobrist_key(index, old_color, old_count) ^ zobrist_key(index, color, count);
+        counts[index] = count;
+        owners[index] = color;
+        bool critical = count + 1 == capacity[index];
+        bool was_critical = old_count + 1 == capacity[index];
+        if (color == old_color && critical == was_critical)
+        {
+            // neighbours see the same owner and criticality as before
+            if (color != ' ')
+                features.orbs[side(color)] += count - old_count;
+            return;
+        }
+        count_cell(index, old_color, old_count, -1);
+        count_cell(index, color, count, 1);
+        const int16_t *adjacent = neighbors + 4 * index;
+        for (int i = 0; i < 4 && adjacent[i] >= 0; i++)
+        {
+            count_pair(adjacent[i], old_color, was_critical, -1);
+            count_pair(adjacent[i], color, critical, 1);
+        }
+    }
+
+    void log_and_write(int index, int count, char color)
+    {
+        if (!move_starts.empty())
+            undo_log.push_back({index, counts[index], owners[index]});
+        write_cell(index, count, color);
+    }
 
 public:
     Board(int rows, int cols)
     {
         this->rows = rows;
         this->cols = cols;
-        grid.resize(rows, vector<Cell>(cols));
+        counts.assign(rows * cols, 0);
+        owners.assign(rows * cols, ' ');
+        Geometry geometry = find_geometry(rows, cols);
+        capacity = geometry.capacity;
+        neighbors = geometry.neighbors;
+        row_lanes = cols >= WAVE_MAX_COLS ? ~0ULL : (1ULL << (4 * cols)) - 1;
+        lane_capacity[0] = lane_capacity[1] = 0;
+        for (int j = 0; j < cols && j < WAVE_MAX_COLS; j++)
+        {
+            lane_capacity[0] |= (uint64_t)critical_mass(0, j, rows, cols) << (4 * j);
+            lane_capacity[1] |= (uint64_t)critical_mass(rows > 2 ? 1 : 0, j, rows, cols) << (4 * j);
+        }
+        features = Features();
+        hash = 0;
+    }
+    // Loads a position from row-major arrays of orb counts and owners. Counts
+    // must be below critical mass; callers check input from outside.
+    Board(int rows, int cols, const uint8_t *orb_counts, const char *cell_owners) : Board(rows, cols)
+    {
+        for (int i = 0; i < rows * cols; i++)
+            if ((cell_owners[i] == 'R' || cell_owners[i] == 'B') && orb_counts[i] > 0)
+                write_cell(i, orb_counts[i], cell_owners[i]);
     }
     Board(const Board &other)
     {
         rows = other.rows;
         cols = other.cols;
-        grid = other.grid;
+        counts = other.counts;
+        owners = other.owners;
+        capacity = other.capacity;
+        neighbors = other.neighbors;
+        row_lanes = other.row_lanes;
+        lane_capacity[0] = other.lane_capacity[0];
+        lane_capacity[1] = other.lane_capacity[1];
+        features = other.features;
+        hash = other.hash;
+    }
+    // Like the copy, leaves the undo history behind; scratch buffers keep
+    // their capacity.
+    Board &operator=(const Board &other)
+    {
+        rows = other.rows;
+        cols = other.cols;
+        counts = other.counts;
+        owners = other.owners;
+        capacity = other.capacity;
+        neighbors = other.neighbors;
+        row_lanes = other.row_lanes;
+        lane_capacity[0] = other.lane_capacity[0];
+        lane_capacity[1] = other.lane_capacity[1];
+        features = other.features;
+        hash = other.hash;
+        undo_log.clear();
+        move_starts.clear();
+        return *this;
     }
 
     // void insert_orb(int row, int col, char color, bool force = false)
@@ -100,100 +356,217 @@ public:
     //     }
     // }
 
+    // Overwrites one cell without triggering explosions, e.g. to load a
+    // saved position. Logged like any other write while a move is applied.
+    void set_cell(int row, int col, int count, char color)
+    {
+        log_and_write(row * cols + col, count, color);
+    }
+
     bool insert_orb(int row, int col, char color)
     {
-        if (grid[row][col].get_color() != ' ' && grid[row][col].get_color() != color)
+        int index = row * cols + col;
+        if (owners[index] != ' ' && owners[index] != color)
         {
             return false;
         }
-        auto &cell = grid[row][col];
-        cell.set_orb_count(cell.get_orb_count() + 1);
-        cell.set_color(color);
-        if (cell.get_orb_count() >= get_critical_mass(row, col))
+        // waves only pay for packing the board once a large share of it is
+        // ready to explode; sparse cascades stay on the queue
+        if (counts[index] + 1 >= capacity[index] && cols <= WAVE_MAX_COLS &&
+            3 * features.critical[side(color)] >= rows * cols)
+            explode_waves(row, col, color);
+        else if (counts[index] + 1 >= capacity[index])
+            explode(row, col, color);
+        else
+            log_and_write(index, counts[index] + 1, color);
+        return true;
+    }
+
+    // Same as insert_orb, but every cell it touches is logged so that
+    // undo_move can restore the board exactly. Used by the search instead
+    // of copying the board for each child.
+    bool apply_move(int row, int col, char color)
+    {
+        move_starts.push_back(undo_log.size());
+        if (insert_orb(row, col, color))
+            return true;
+        move_starts.pop_back();
+        return false;
+    }
+
+    void undo_move()
+    {
+        int start = move_starts.back();
+        move_starts.pop_back();
+        while ((int)undo_log.size() > start)
         {
-            explode(row, col);
+            const Change &change = undo_log.back();
+            write_cell(change.index, change.orb_count, change.color);
+            undo_log.pop_back();
         }
-        return true;
     }
 
-    void explode(int row, int col)
+    // Empties the cell and throws its orbs, which all belong to `color`,
+    // the player who set it off. A neighbour that reaches critical mass is
+    // emptied right away and explodes in turn.
+    void explode(int row, int col, char color)
     {
-        queue<pair<int, int>> explosion_queue;
-        explosion_queue.push({row, col});
-        grid[row][col].set_orb_count(0);
-        grid[row][col].set_color(' ');
-        int dx[4] = {-1, 0, 1, 0};
-        int dy[4] = {0, 1, 0, -1};
-        while (!explosion_queue.empty())
+        explosion_queue.clear();
+        explosion_queue.push_back(row * cols + col);
+        log_and_write(row * cols + col, 0, ' ');
+        for (size_t head = 0; head < explosion_queue.size(); head++)
         {
-            if(is_game_over())
+            // the cascade is over once the opponent has no cells left; on a
+            // crowded board it could otherwise run forever. Cells still
+            // waiting to explode keep one orb short of critical mass, so
+            // the mover is left with cells.
+            if (features.cells[1 - side(color)] == 0)
             {
+                for (size_t rest = head; rest < explosion_queue.size(); rest++)
+                    log_and_write(explosion_queue[rest], capacity[explosion_queue[rest]] - 1, color);
                 return; 
             }
-            auto front = explosion_queue.front();
-            explosion_queue.pop();
-            int r = front.first;
-            int c = front.second;
-            for (int i = 0; i < 4; i++)
+            const int16_t *adjacent = neighbors + 4 * explosion_queue[head];
+            for (int i = 0; i < 4 && adjacent[i] >= 0; i++)
             {
-                int new_row = r + dx[i];
-                int new_col = c + dy[i];
-                if (new_row >= 0 && new_row < rows && new_col >= 0 && new_col < cols)
+                int neighbor = adjacent[i];
+                if (counts[neighbor] + 1 >= capacity[neighbor])
                 {
-                    auto &neighbor_cell = grid[new_row][new_col];
-                    neighbor_cell.set_orb_count(neighbor_cell.get_orb_count() + 1);
-                    neighbor_cell.set_color(grid[r][c].get_color());
-                    if (neighbor_cell.get_orb_count() >= get_critical_mass(new_row, new_col))
-                    {
-                        explosion_queue.push({new_row, new_col});
-                        neighbor_cell.set_orb_count(0);
-                        neighbor_cell.set_color(' ');
-                    }
+                    explosion_queue.push_back(neighbor);
+                    log_and_write(neighbor, 0, ' ');
                 }
+                else
+                    log_and_write(neighbor, counts[neighbor] + 1, color);
             }
         }
     }
+
+    // Same result as explode for a cascade that does not end the game,
+    // computed a wave at a time: every cell at critical mass topples at
+    // once, using SWAR arithmetic on rows packed 4 bits per cell. A cell
+    // never holds more than 7 orbs here (it loses its critical mass and
+    // gets at most that many back per wave), so lanes cannot overflow.
+    // Stops after the wave that removes the opponent's last cell, so a
+    // game-ending cascade has the same winner but may differ in the final
+    // orbs. Needs cols <= WAVE_MAX_COLS.
+    void explode_waves(int row, int col, char color)
+    {
+        const uint64_t LOW = 0x1111111111111111ULL & row_lanes;
+        const uint64_t HIGH = LOW << 3;
+        char enemy = color == 'R' ? 'B' : 'R';
+        wave_counts.assign(rows, 0);
+        wave_critical.assign(rows, 0);
+        wave_touched.assign(rows, 0);
+        wave_enemy.assign(rows, 0);
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++)
+            {
+                wave_counts[i] |= (uint64_t)counts[i * cols + j] << (4 * j);
+                if (owners[i * cols + j] == enemy)
+                    wave_enemy[i] |= 0xFULL << (4 * j);
+            }
+        wave_counts[row] += 1ULL << (4 * col);
+        wave_touched[row] |= 0xFULL << (4 * col);
+
+        while (true)
+        {
+            // lanes at critical mass: count + (8 - capacity) sets the lane's top bit
+            uint64_t any = 0;
+            for (int i = 0; i < rows; i++)
+            {
+                uint64_t capacity_lanes = lane_capacity[i == 0 || i == rows - 1 ? 0 : 1];
+                wave_critical[i] = ((wave_counts[i] + (8 * LOW - capacity_lanes)) & HIGH) >> 3;
+                wave_counts[i] -= (wave_critical[i] * 15) & capacity_lanes;
+                any |= wave_critical[i];
+            }
+            if (!any)
+                break;
+            uint64_t enemy_left = 0;
+            for (int i = 0; i < rows; i++)
+            {
+                uint64_t above = i > 0 ? wave_critical[i - 1] : 0;
+                uint64_t below = i < rows - 1 ? wave_critical[i + 1] : 0;
+                uint64_t right = (wave_critical[i] << 4) & row_lanes, left = wave_critical[i] >> 4;
+                wave_counts[i] += right + left + above + below;
+                wave_touched[i] |= (wave_critical[i] | right | left | above | below) * 15;
+                enemy_left |= wave_enemy[i] & ~wave_touched[i];
+            }
+            if (!enemy_left)
+            {
+                // cells still at critical mass keep one orb short of it;
+                // emptying them could leave the mover without cells too
+                for (int i = 0; i < rows; i++)
+                {
+                    uint64_t capacity_lanes = lane_capacity[i == 0 || i == rows - 1 ? 0 : 1];
+                    uint64_t critical = (((wave_counts[i] + (8 * LOW - capacity_lanes)) & HIGH) >> 3) * 15;
+                    wave_counts[i] = (wave_counts[i] & ~critical) | ((capacity_lanes - LOW) & critical);
+                }
+                break;
+            }
+        }
+
+        for (int i = 0; i < rows; i++)
+            for (uint64_t lanes = wave_touched[i] & LOW; lanes; lanes &= lanes - 1)
+            {
+                int shift = __builtin_ctzll(lanes);
+                int count = (wave_counts[i] >> shift) & 0xF;
+                log_and_write(i * cols + shift / 4, count, count > 0 ? color : ' ');
+            }
+    }
+
     vector<pair<int, int>> get_valid_moves(char color) const
     {
         vector<pair<int, int>> moves;
+        get_valid_moves(color, moves);
+        return moves;
+    }
+
+    void get_valid_moves(char color, vector<pair<int, int>> &moves) const
+    {
+        moves.clear();
         for (int i = 0; i < rows; i++)
             for (int j = 0; j < cols; j++)
-                if (grid[i][j].get_color() == color || grid[i][j].get_color() == ' ')
+                if (owners[i * cols + j] == color || owners[i * cols + j] == ' ')
                     moves.push_back({i, j});
-        return moves;
+    }
+
+    // Moves that set off an explosion: own cells one orb short of critical mass.
+    void get_explosive_moves(char color, vector<pair<int, int>> &moves) const
+    {
+        moves.clear();
+        for (int i = 0; i < rows * cols; i++)
+            if (owners[i] == color && counts[i] + 1 >= capacity[i])
+                moves.push_back({i / cols, i % cols});
     }
 
     int get_score(char color) const
     {
-        int score = 0;
-        for (int i = 0; i < rows; i++)
-            for (int j = 0; j < cols; j++)
-            {
-                if (grid[i][j].get_color() == color)
-                {
-                    score += grid[i][j].get_orb_count();
-                }
-            }
-        return score;
+        if (color != 'R' && color != 'B')
+            return 0;
+        return features.orbs[side(color)];
     }
 
+    const Features &get_features() const { return features; }
+
     bool is_game_over() const
     {
+        // only scan when a single color is left on more than one cell
+        if (features.cells[0] > 0 && features.cells[1] > 0)
+            return false;
+        if (features.cells[0] + features.cells[1] < 2)
+            return false;
         char first_color = ' ';
         int orb_count = 0;
-        for (int i = 0; i < rows; i++)
+        for (int i = 0; i < rows * cols; i++)
         {
-            for (int j = 0; j < cols; j++)
-            {
-                if (grid[i][j].get_color() == ' ')
-                    continue;
-                if (first_color == ' ')
-                    first_color = grid[i][j].get_color();
-                else if (grid[i][j].get_color() != first_color)
-                    return false;
-                else
-                    orb_count += grid[i][j].get_orb_count();
-            }
+            if (owners[i] == ' ')
+                continue;
+            if (first_color == ' ')
+                first_color = owners[i];
+            else if (owners[i] != first_color)
+                return false;
+            else
+                orb_count += counts[i];
         }
         return orb_count >= 2;
     }
@@ -202,44 +575,41 @@ public:
     {
         if (row < 0 || row >= rows || col < 0 || col >= cols)
             return 0;
-        return grid[row][col].get_orb_count();
+        return counts[row * cols + col];
     }
 
     char get_color(int row, int col) const
     {
         if (row < 0 || row >= rows || col < 0 || col >= cols)
             return ' ';
-        return grid[row][col].get_color();
+        return owners[row * cols + col];
     }
 
+    uint64_t get_hash() const { return hash; }
+    const uint8_t *get_counts() const { return counts.data(); }
+    const char *get_owners() const { return owners.data(); }
     int get_rows() const { return rows; }
     int get_cols() const { return cols; }
 
-    bool is_corner(int row, int col)
+    bool is_corner(int row, int col) const
     {
         return (row == 0 && col == 0) || (row == 0 && col == cols - 1) ||
                (row == rows - 1 && col == 0) || (row == rows - 1 && col == cols - 1);
     }
 
-    bool is_edge(int row, int col)
+    bool is_edge(int row, int col) const
     {
         return (row == 0 || row == rows - 1 || col == 0 || col == cols - 1) && !is_corner(row, col);
     }
 
-    bool is_center(int row, int col)
+    bool is_center(int row, int col) const
     {
         return (row > 0 && row < rows - 1 && col > 0 && col < cols - 1);
     }
 
-    int get_critical_mass(int row, int col)
+    int get_critical_mass(int row, int col) const
     {
-        if (is_corner(row, col))
-            return 2;
-        else if (is_edge(row, col))
-            return 3;
-        else if (is_center(row, col))
-            return 4;
-        return 4;
+        return critical_mass(row, col, rows, cols);
     }
 };
 
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include "board.hpp"
+#include "player.hpp"
+#include "opening_book.hpp"
+
+using namespace std;
+
+// Builds an opening book for AI::set_book. Every position up to
+// `full` plies from the empty board is searched, and beyond that the book
+// follows only the moves it picked itself, up to `plies` plies.
+//
+//   book_gen [-b RxC] [-p plies] [-f full] [-d depth] [-t time_ms] [-j jobs] [-o file]
+//
+// Defaults: 5x6, 6 plies, 2 full plies, depth 20 cut off at 300 ms per
+// position, one job per hardware thread, book.bin.
+
+struct Position
+{
+    Board board;
+    char to_move;
+};
+
+int main(int argc, char *argv[])
+{
+    int rows = 5, cols = 6, plies = 6, full = 2, depth = 20, time_ms = 300;
+    int jobs = max(1u, thread::hardware_concurrency());
+    string output = "book.bin";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string arg = argv[i], value = argv[i + 1];
+        if (arg == "-b" && sscanf(value.c_str(), "%dx%d", &rows, &cols) == 2 && rows >= 2 && cols >= 2)
+            continue;
+        else if (arg == "-p")
+            plies = atoi(value.c_str());
+        else if (arg == "-f")
+            full = atoi(value.c_str());
+        else if (arg == "-d")
+            depth = atoi(value.c_str());
+        else if (arg == "-t")
+            time_ms = atoi(value.c_str());
+        else if (arg == "-j")
+            jobs = max(1, atoi(value.c_str()));
+        else if (arg == "-o")
+            output = value;
+        else
+        {
+            cerr << "usage: book_gen [-b RxC] [-p plies] [-f full] [-d depth] [-t time_ms] [-j jobs] [-o file]\n";
+            return 1;
+        }
+    }
+    if ((argc - 1) % 2 != 0)
+    {
+        cerr << "usage: book_gen [-b RxC] [-p plies] [-f full] [-d depth] [-t time_ms] [-j jobs] [-o file]\n";
+        return 1;
+    }
+
+    vector<BookEntry> entries;
+    vector<Position> level = {{Board(rows, cols), 'R'}};
+    for (int ply = 0; ply < plies && !level.empty(); ply++)
+    {
+        vector<pair<int, int>> best(level.size());
+        vector<int> depths(level.size());
+        atomic<int> next(0);
+        vector<thread> workers;
+        for (int j = 0; j < jobs; j++)
+        {
+            workers.emplace_back([&]()
+                                 {
+                // one AI per colour and job, so their tables stay warm
+                AI red('R', depth, time_ms), blue('B', depth, time_ms);
+                for (int i = next++; i < (int)level.size(); i = next++)
+                {
+                    AI &ai = level[i].to_move == 'R' ? red : blue;
+                    Board copy = level[i].board;
+                    ai.make_move(copy);
+                    best[i] = ai.get_last_move();
+                    depths[i] = ai.get_completed_depth();
+                } });
+        }
+        for (auto &worker : workers)
+            worker.join();
+
+        vector<Position> next_level;
+        unordered_set<uint64_t> seen;
+        for (size_t i = 0; i < level.size(); i++)
+        {
+            const Position &position = level[i];
+            entries.push_back({book_key(position.board, position.to_move), (uint32_t)(best[i].first * cols + best[i].second),
+                               (uint32_t)depths[i]});
+            char other = position.to_move == 'R' ? 'B' : 'R';
+            vector<pair<int, int>> moves;
+            if (ply < full)
+                moves = position.board.get_valid_moves(position.to_move);
+            else
+                moves.push_back(best[i]);
+            for (auto move : moves)
+            {
+                Board child = position.board;
+                child.insert_orb(move.first, move.second, position.to_move);
+                if (!child.is_game_over() && seen.insert(book_key(child, other)).second)
+                    next_level.push_back({child, other});
+            }
+        }
+        cerr << "ply " << ply << ": " << level.size() << " positions\n";
+        level = move(next_level);
+    }
+
+    if (!OpeningBook::write(output, entries))
+    {
+        cerr << "cannot write " << output << "\n";
+        return 1;
+    }
+    OpeningBook book(output);
+    cout << "wrote " << book.size() << " positions to " << output << "\n";
+    return 0;
+}
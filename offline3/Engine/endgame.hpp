@@ -0,0 +1,129 @@
+#ifndef ENDGAME_HPP
+#define ENDGAME_HPP
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "board.hpp"
+using namespace std;
+
+// Exact win/loss search for the late game. Scores are +1 (the side to move
+// can force a win), -1 (every move loses) or 0 (not decided within the
+// depth). Deepens one ply at a time until the position is decided or the
+// node budget (counted in moves tried), the deadline or the stop flag
+// ends it, so a result of +1 or -1 is a proof.
+class EndgameSolver
+{
+    vector<vector<pair<int, int>>> move_lists; // one buffer per ply
+    long long nodes, node_limit;
+    chrono::steady_clock::time_point deadline;
+    const atomic<bool> *stop_flag;
+    bool aborted;
+
+    static char other(char color) { return color == 'R' ? 'B' : 'R'; }
+
+    // explosions first: they are the moves that win or defend
+    void ordered_moves(const Board &b, char color, vector<pair<int, int>> &moves)
+    {
+        b.get_valid_moves(color, moves);
+        stable_partition(moves.begin(), moves.end(), [&](pair<int, int> move)
+                         { return b.get_color(move.first, move.second) == color &&
+                                  b.get_orb_count(move.first, move.second) + 1 >= b.get_critical_mass(move.first, move.second); });
+    }
+
+    bool out_of_time() const
+    {
+        return (stop_flag && stop_flag->load(memory_order_relaxed)) || chrono::steady_clock::now() >= deadline;
+    }
+
+    int solve(Board &b, char color, int depth, int ply)
+    {
+        auto &moves = move_lists[ply];
+        ordered_moves(b, color, moves);
+
+        // a move that ends the game wins it
+        for (auto move : moves)
+        {
+            if (++nodes > node_limit || ((nodes & 63) == 0 && out_of_time()))
+            {
+                aborted = true;
+                return 0;
+            }
+            b.apply_move(move.first, move.second, color);
+            bool won = b.is_game_over();
+            b.undo_move();
+            if (won)
+                return 1;
+        }
+        if (depth <= 1)
+            return 0;
+
+        bool undecided = false;
+        for (auto move : moves)
+        {
+            b.apply_move(move.first, move.second, color);
+            int result = -solve(b, other(color), depth - 1, ply + 1);
+            b.undo_move();
+            if (aborted)
+                return 0;
+            if (result == 1)
+                return 1;
+            if (result == 0)
+                undecided = true;
+        }
+        return undecided ? 0 : -1;
+    }
+
+public:
+    EndgameSolver()
+    {
+        nodes = 0;
+        node_limit = 0;
+        stop_flag = nullptr;
+        aborted = false;
+    }
+
+    long long get_nodes() const { return nodes; }
+
+    // Proves the position for `color` to move. On +1, `move` wins by force.
+    int solve(Board &b, char color, long long limit, int max_depth, pair<int, int> &move,
+              chrono::steady_clock::time_point until = chrono::steady_clock::time_point::max(),
+              const atomic<bool> *stop = nullptr)
+    {
+        nodes = 0;
+        node_limit = limit;
+        deadline = until;
+        stop_flag = stop;
+        aborted = false;
+        if ((int)move_lists.size() < max_depth)
+            move_lists.resize(max_depth);
+        vector<pair<int, int>> moves;
+        ordered_moves(b, color, moves);
+        for (int depth = 1; depth <= max_depth && !aborted; depth++)
+        {
+            bool undecided = false;
+            for (auto candidate : moves)
+            {
+                nodes++;
+                b.apply_move(candidate.first, candidate.second, color);
+                int result = b.is_game_over() ? 1 : (depth > 1 ? -solve(b, other(color), depth - 1, 0) : 0);
+                b.undo_move();
+                if (aborted)
+                    return 0;
+                if (result == 1)
+                {
+                    move = candidate;
+                    return 1;
+                }
+                if (result == 0)
+                    undecided = true;
+            }
+            if (!undecided)
+                return -1;
+        }
+        return 0;
+    }
+};
+
+#endif
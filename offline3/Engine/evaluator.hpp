@@ -0,0 +1,64 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include "board.hpp"
+using namespace std;
+
+// Scores a position for `color`; higher is better for that player. The AI
+// calls this at every leaf, so implementations should only read the
+// board's incrementally kept Features rather than scan the grid.
+class Evaluator
+{
+public:
+    virtual ~Evaluator() {}
+    virtual int evaluate(const Board &b, char color) const = 0;
+};
+
+// The original evaluation: own orbs minus the opponent's.
+class OrbEvaluator : public Evaluator
+{
+public:
+    int evaluate(const Board &b, char color) const override
+    {
+        char oponent_color = (color == 'R') ? 'B' : 'R';
+        return b.get_score(color) - b.get_score(oponent_color);
+    }
+};
+
+// Weighted sum of the board features, own minus the opponent's. A finished
+// game scores WIN_SCORE for the winner.
+class FeatureEvaluator : public Evaluator
+{
+public:
+    struct Weights
+    {
+        int orbs = 1;
+        int critical = 2;
+        int corners = 3;
+        int edges = 2;
+        int vulnerable = -3;
+        int chains = 2;
+    };
+    static const int WIN_SCORE = 10000;
+
+    Weights weights;
+
+    FeatureEvaluator() {}
+    FeatureEvaluator(const Weights &weights) : weights(weights) {}
+
+    int evaluate(const Board &b, char color) const override
+    {
+        const Features &f = b.get_features();
+        int me = color == 'R' ? 0 : 1, op = 1 - me;
+        if (b.is_game_over())
+            return f.cells[me] > 0 ? WIN_SCORE : -WIN_SCORE;
+        return weights.orbs * (f.orbs[me] - f.orbs[op]) +
+               weights.critical * (f.critical[me] - f.critical[op]) +
+               weights.corners * (f.corners[me] - f.corners[op]) +
+               weights.edges * (f.edges[me] - f.edges[op]) +
+               weights.vulnerable * (f.vulnerable[me] - f.vulnerable[op]) +
+               weights.chains * (f.chains[me] - f.chains[op]);
+    }
+};
+
+#endif
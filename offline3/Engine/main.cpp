@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cstdlib>
 #include "board.hpp"
 #include "player.hpp"
 
@@ -21,9 +22,10 @@ void print_board(Board &board)
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
-    const int ROWS = 5, COLS = 6; // Board size
+    // Board size, 5x6 unless given as: main <rows> <cols>
+    const int ROWS = argc > 2 ? atoi(argv[1]) : 5, COLS = argc > 2 ? atoi(argv[2]) : 6;
     Board board(ROWS, COLS);
 
     AI player1('R', 2); // Player 1: Human, Red
@@ -0,0 +1,115 @@
+#ifndef OPENING_BOOK_HPP
+#define OPENING_BOOK_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "board.hpp"
+using namespace std;
+
+// One book position. The file is the 8-byte magic followed by entries
+// sorted by key, so a lookup is a binary search over the mapped file.
+struct BookEntry
+{
+    uint64_t key;
+    uint32_t move;  // row * cols + col
+    uint32_t depth; // depth the move was searched to
+};
+
+const char BOOK_MAGIC[8] = {'C', 'R', 'B', 'O', 'O', 'K', '1', '\0'};
+
+// Zobrist keys only know cell indices, so the board size and the side to
+// move are mixed in to keep positions of different boards apart.
+inline uint64_t book_key(const Board &b, char to_move)
+{
+    uint64_t size = (uint64_t)b.get_rows() << 16 | (uint64_t)b.get_cols();
+    size = (size + 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+    return b.get_hash() ^ (size ^ (size >> 31)) ^ (to_move == 'B' ? 0x5851F42D4C957F2DULL : 0);
+}
+
+class OpeningBook
+{
+    void *mapping;
+    size_t mapped_size;
+    const BookEntry *entries;
+    size_t count;
+
+public:
+    // An unreadable or malformed file gives an empty book.
+    OpeningBook(const string &path)
+    {
+        mapping = nullptr;
+        mapped_size = 0;
+        entries = nullptr;
+        count = 0;
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(BOOK_MAGIC) &&
+            (info.st_size - sizeof(BOOK_MAGIC)) % sizeof(BookEntry) == 0)
+        {
+            void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                if (memcmp(data, BOOK_MAGIC, sizeof(BOOK_MAGIC)) == 0)
+                {
+                    mapping = data;
+                    mapped_size = info.st_size;
+                    entries = (const BookEntry *)((const char *)data + sizeof(BOOK_MAGIC));
+                    count = (info.st_size - sizeof(BOOK_MAGIC)) / sizeof(BookEntry);
+                }
+                else
+                    munmap(data, info.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+
+    ~OpeningBook()
+    {
+        if (mapping)
+            munmap(mapping, mapped_size);
+    }
+
+    size_t size() const { return count; }
+
+    bool probe(const Board &b, char to_move, BookEntry &entry) const
+    {
+        uint64_t key = book_key(b, to_move);
+        const BookEntry *end = entries + count;
+        const BookEntry *found = lower_bound(entries, end, key, [](const BookEntry &e, uint64_t k)
+                                             { return e.key < k; });
+        if (found == end || found->key != key)
+            return false;
+        entry = *found;
+        return true;
+    }
+
+    // Sorts the entries, keeps the deepest one per key and writes the file.
+    static bool write(const string &path, vector<BookEntry> entries)
+    {
+        sort(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b)
+             { return a.key != b.key ? a.key < b.key : a.depth > b.depth; });
+        entries.erase(unique(entries.begin(), entries.end(), [](const BookEntry &a, const BookEntry &b)
+                             { return a.key == b.key; }),
+                      entries.end());
+        FILE *file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        bool ok = fwrite(BOOK_MAGIC, sizeof(BOOK_MAGIC), 1, file) == 1 &&
+                  fwrite(entries.data(), sizeof(BookEntry), entries.size(), file) == entries.size();
+        return fclose(file) == 0 && ok;
+    }
+};
+
+#endif
@@ -3,12 +3,26 @@
 
 #pragma once
 #include <climits>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
 #include "board.hpp"
+#include "transposition.hpp"
+#include "evaluator.hpp"
+#include "opening_book.hpp"
+#include "endgame.hpp"
 
 class player
 {
 public:
     player() = default;
+    virtual ~player() = default;
     virtual bool make_move(Board &b, int row, int col) = 0;
 };
 
@@ -33,93 +47,933 @@ public:
 
 class AI : public player
 {
-    char color;
-    int depth;
-    int evaluate(const Board &b, char color) 
+    // Search state owned by one thread. Workers of the same AI share only
+    // its transposition table, stop flag and deadline.
+    struct Worker
     {
-        char oponent_color = (color == 'R') ? 'B' : 'R';
-        int score = 0;
-        score += b.get_score(color);
-        score -= b.get_score(oponent_color);
-        return score;
-    }
+        AI *ai;
+        vector<vector<pair<int, int>>> move_lists; // one buffer per ply
+        vector<array<int, 2>> killers;              // last two cutoff moves at each ply
+        vector<int> history[2];                     // cutoff credit per cell, indexed by side
+        long long nodes;
+        bool exact_depth; // only take table scores searched to exactly the same depth
+        int quiet_nodes_left; // quiescence budget for the current leaf
 
-    int minimax(const Board &board, int depth, int alpha, int beta, bool maximizing, char player_color)
-    {
-        if (depth == 0 || board.is_game_over())
-            return evaluate(board, color);
+        void reset(int max_depth, int cells)
+        {
+            move_lists.resize(max_depth + 2 + QUIESCENCE_PLIES);
+            killers.assign(max_depth + 2, {-1, -1});
+            for (auto &h : history)
+            {
+                h.resize(cells, 0);
+                for (auto &value : h)
+                    value /= 8;
+            }
+            nodes = 0;
+        }
 
-        auto moves = board.get_valid_moves(maximizing ? player_color : (player_color == 'R' ? 'B' : 'R'));
-        if (moves.empty())
-            return evaluate(board, color);
+        bool out_of_time()
+        {
+            if ((nodes & 63) == 0 &&
+                ((ai->stop_flag && ai->stop_flag->load(memory_order_relaxed)) ||
+                 (ai->time_limit_ms > 0 && chrono::steady_clock::now() >= ai->deadline)))
+                ai->stopped = true;
+            return ai->stopped.load(memory_order_relaxed);
+        }
+
+        int order_score(int cell, int tt_move, int ply, int side) const
+        {
+            if (cell == tt_move)
+                return INT_MAX;
+            if (cell == killers[ply][0])
+                return INT_MAX - 1;
+            if (cell == killers[ply][1])
+                return INT_MAX - 2;
+            return history[side][cell];
+        }
+
+        // Hash move first, then killers, then by history; ties keep board order.
+        void order_moves(vector<pair<int, int>> &moves, int cols, int tt_move, int ply, int side)
+        {
+            sort(moves.begin(), moves.end(), [&](const pair<int, int> &a, const pair<int, int> &b)
+                 {
+                     int cell_a = a.first * cols + a.second, cell_b = b.first * cols + b.second;
+                     int score_a = order_score(cell_a, tt_move, ply, side);
+                     int score_b = order_score(cell_b, tt_move, ply, side);
+                     if (score_a != score_b)
+                         return score_a > score_b;
+                     return cell_a < cell_b; });
+        }
+
+        void record_cutoff(int cell, int depth, int ply, int side)
+        {
+            if (killers[ply][0] != cell)
+            {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = cell;
+            }
+            history[side][cell] += depth * depth;
+            if (history[side][cell] > (1 << 20))
+                for (auto &h : history[side])
+                    h /= 2;
+        }
+
+        int minimax(Board &board, int depth, int ply, int alpha, int beta, bool maximizing, char player_color)
+        {
+            nodes++;
+            if (out_of_time())
+                return 0;
+            if (board.is_game_over())
+                return ai->evaluator->evaluate(board, ai->color);
+            if (depth == 0)
+            {
+                if (!ai->quiescence)
+                    return ai->evaluator->evaluate(board, ai->color);
+                quiet_nodes_left = QUIESCENCE_NODES;
+                return quiesce(board, QUIESCENCE_PLIES, ply, alpha, beta, maximizing, player_color);
+            }
+
+            // the same cells can come up with either side to move
+            uint64_t key = board.get_hash() ^ (maximizing ? 0 : SIDE_TO_MOVE_KEY);
+            int alpha_in = alpha, beta_in = beta;
+            int tt_move = -1;
+            TTEntry entry;
+            // nodes one ply above the leaves are cheaper to search than to look up
+            if (depth > 1 && ai->table.probe(key, entry))
+            {
+                tt_move = entry.move;
+                if (entry.depth == depth || (entry.depth > depth && !exact_depth))
+                {
+                    if (entry.bound == EXACT)
+                        return entry.score;
+                    if (entry.bound == LOWER)
+                        alpha = max(alpha, entry.score);
+                    else
+                        beta = min(beta, entry.score);
+                    if (beta <= alpha)
+                        return entry.score;
+                }
+            }
+
+            auto &moves = move_lists[ply];
+            board.get_valid_moves(maximizing ? player_color : (player_color == 'R' ? 'B' : 'R'), moves);
+            if (moves.empty())
+                return ai->evaluator->evaluate(board, ai->color);
+
+            int cols = board.get_cols();
+            int side = maximizing ? 0 : 1;
+            order_moves(moves, cols, tt_move, ply, side);
+
+            int best;
+            pair<int, int> bestMove = moves[0];
+            if (maximizing)
+            {
+                int maxEval = INT_MIN;
+                for (auto move : moves)
+                {
+                    auto r = move.first;
+                    auto c = move.second;
+                    board.apply_move(r, c, player_color);
+                    int eval = minimax(board, depth - 1, ply + 1, alpha, beta, false, player_color);
+                    board.undo_move();
+                    if (ai->stopped.load(memory_order_relaxed))
+                        return 0;
+                    if (eval > maxEval)
+                    {
+                        maxEval = eval;
+                        bestMove = move;
+                    }
+                    alpha = max(alpha, eval);
+                    if (beta <= alpha)
+                    {
+                        record_cutoff(r * cols + c, depth, ply, side);
+                        break;
+                    }
+                }
+                best = maxEval;
+            }
+            else
+            {
+                int minEval = INT_MAX;
+                char opp = (player_color == 'R' ? 'B' : 'R');
+                for (auto move : moves)
+                {
+                    auto r = move.first;
+                    auto c = move.second;
+                    board.apply_move(r, c, opp);
+                    int eval = minimax(board, depth - 1, ply + 1, alpha, beta, true, player_color);
+                    board.undo_move();
+                    if (ai->stopped.load(memory_order_relaxed))
+                        return 0;
+                    if (eval < minEval)
+                    {
+                        minEval = eval;
+                        bestMove = move;
+                    }
+                    beta = min(beta, eval);
+                    if (beta <= alpha)
+                    {
+                        record_cutoff(r * cols + c, depth, ply, side);
+                        break;
+                    }
+                }
+                best = minEval;
+            }
+
+            Bound bound = EXACT;
+            if (best <= alpha_in)
+                bound = UPPER;
+            else if (best >= beta_in)
+                bound = LOWER;
+            if (depth > 1)
+                ai->table.store(key, {best, depth, bound, bestMove.first * cols + bestMove.second});
+            return best;
+        }
 
-        if (maximizing)
+        // Searches the root moves in order, sharing the (alpha, beta) window
+        // between siblings. `bestMove` is only updated by fully searched moves.
+        int search_root(Board &b, vector<pair<int, int>> &moves, int depth, int alpha, int beta, pair<int, int> &bestMove)
         {
-            int maxEval = INT_MIN;
+            int best = INT_MIN;
             for (auto move : moves)
             {
-                auto r = move.first;
-                auto c = move.second;
-                Board temp = board;
-                temp.insert_orb(r, c, player_color);
-                int eval = minimax(temp, depth - 1, alpha, beta, false, player_color);
-                maxEval = max(maxEval, eval);
-                alpha = max(alpha, eval);
+                b.apply_move(move.first, move.second, ai->color);
+                int score = minimax(b, depth, 1, alpha, beta, false, ai->color);
+                b.undo_move();
+                if (ai->stopped.load(memory_order_relaxed))
+                    break;
+                if (score > best)
+                {
+                    best = score;
+                    bestMove = move;
+                }
+                alpha = max(alpha, score);
                 if (beta <= alpha)
                     break;
             }
-            return maxEval;
+            return best;
         }
-        else
+
+        // Static exchange estimate for exploding (row, col): the enemy orbs
+        // next to it, which the first wave takes over. Anything further
+        // down the cascade is left to the search.
+        static int exchange_estimate(const Board &board, int row, int col, char color)
+        {
+            int dx[4] = {-1, 0, 1, 0};
+            int dy[4] = {0, 1, 0, -1};
+            int gain = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char owner = board.get_color(row + dx[i], col + dy[i]);
+                if (owner != ' ' && owner != color)
+                    gain += board.get_orb_count(row + dx[i], col + dy[i]);
+            }
+            return gain;
+        }
+
+        // Past the nominal depth, keep searching explosions that capture
+        // enemy orbs until the position is quiet. The side to move may also
+        // stand pat on the static score. Bounded by QUIESCENCE_PLIES and by
+        // the per-leaf node budget.
+        int quiesce(Board &board, int plies_left, int ply, int alpha, int beta, bool maximizing, char player_color)
         {
-            int minEval = INT_MAX;
-            char opp = (player_color == 'R' ? 'B' : 'R');
+            int stand_pat = ai->evaluator->evaluate(board, ai->color);
+            if (board.is_game_over() || plies_left == 0 || quiet_nodes_left <= 0)
+                return stand_pat;
+            if (maximizing ? stand_pat >= beta : stand_pat <= alpha)
+                return stand_pat;
+            if (maximizing)
+                alpha = max(alpha, stand_pat);
+            else
+                beta = min(beta, stand_pat);
+
+            char mover = maximizing ? player_color : (player_color == 'R' ? 'B' : 'R');
+            auto &moves = move_lists[ply];
+            board.get_explosive_moves(mover, moves);
+            // reuse the buffer for (estimate, cell) of the moves that capture
+            int cols = board.get_cols();
+            size_t count = 0;
             for (auto move : moves)
             {
-                auto r = move.first;
-                auto c = move.second;
-                Board temp = board;
-                temp.insert_orb(r, c, opp);
-                int eval = minimax(temp, depth - 1, alpha, beta, true, player_color);
-                minEval = min(minEval, eval);
-                beta = min(beta, eval);
+                int gain = exchange_estimate(board, move.first, move.second, mover);
+                if (gain > 0)
+                    moves[count++] = {gain, move.first * cols + move.second};
+            }
+            moves.resize(count);
+            sort(moves.begin(), moves.end(), greater<pair<int, int>>());
+
+            int best = stand_pat;
+            for (auto capture : moves)
+            {
+                if (quiet_nodes_left-- <= 0)
+                    break;
+                nodes++;
+                if (out_of_time())
+                    return 0;
+                board.apply_move(capture.second / cols, capture.second % cols, mover);
+                int eval = quiesce(board, plies_left - 1, ply + 1, alpha, beta, !maximizing, player_color);
+                board.undo_move();
+                if (maximizing)
+                {
+                    best = max(best, eval);
+                    alpha = max(alpha, eval);
+                }
+                else
+                {
+                    best = min(best, eval);
+                    beta = min(beta, eval);
+                }
                 if (beta <= alpha)
                     break;
             }
-            return minEval;
+            return best;
+        }
+
+        // Iterative deepening with aspiration windows from `first_depth` up to
+        // the AI's depth. Returns the last depth that finished.
+        int deepen(Board &b, vector<pair<int, int>> moves, int first_depth, int pv_move, pair<int, int> &bestMove)
+        {
+            int cols = b.get_cols();
+            int score = 0;
+            int completed = 0;
+            for (int d = first_depth; d <= ai->depth; d++)
+            {
+                order_moves(moves, cols, pv_move, 0, 0);
+
+                // aspiration window around the previous iteration's score
+                int delta = ASPIRATION_WINDOW;
+                bool aspire = d > first_depth;
+                int alpha = aspire ? max((long long)INT_MIN, (long long)score - delta) : INT_MIN;
+                int beta = aspire ? min((long long)INT_MAX, (long long)score + delta) : INT_MAX;
+                pair<int, int> iterationMove = moves[0];
+                while (true)
+                {
+                    int result = search_root(b, moves, d, alpha, beta, iterationMove);
+                    if (ai->stopped.load(memory_order_relaxed))
+                        break;
+                    delta *= 4;
+                    if (result <= alpha && alpha != INT_MIN)
+                        alpha = delta > 256 ? INT_MIN : max((long long)INT_MIN, (long long)score - delta);
+                    else if (result >= beta && beta != INT_MAX)
+                        beta = delta > 256 ? INT_MAX : min((long long)INT_MAX, (long long)score + delta);
+                    else
+                    {
+                        score = result;
+                        break;
+                    }
+                }
+                if (ai->stopped.load(memory_order_relaxed))
+                    break;
+                bestMove = iterationMove;
+                completed = d;
+                pv_move = bestMove.first * cols + bestMove.second;
+                if (this == &ai->workers[0])
+                    ai->publish(bestMove, d);
+
+                // the next iteration costs more than all earlier ones together
+                auto elapsed = chrono::steady_clock::now() - ai->start;
+                if (ai->time_limit_ms > 0 && elapsed * 2 > chrono::milliseconds(ai->time_limit_ms))
+                    break;
+            }
+            return completed;
+        }
+
+        // Root splitting: takes root moves off the shared counter and scores
+        // each with the window (best - 1, +inf), so every move that can tie
+        // or beat the best gets an exact score whatever the timing.
+        void search_split(Board &b, const vector<pair<int, int>> &moves, int depth, atomic<int> &next,
+                          atomic<int> &best, vector<int> &scores)
+        {
+            for (int i = next++; i < (int)moves.size(); i = next++)
+            {
+                int alpha = best.load();
+                alpha = alpha == INT_MIN ? INT_MIN : alpha - 1;
+                b.apply_move(moves[i].first, moves[i].second, ai->color);
+                int score = minimax(b, depth, 1, alpha, INT_MAX, false, ai->color);
+                b.undo_move();
+                if (ai->stopped.load(memory_order_relaxed))
+                    return;
+                scores[i] = score;
+                int current = best.load();
+                while (score > current && !best.compare_exchange_weak(current, score))
+                    ;
+            }
+        }
+    };
+
+    char color;
+    int depth;
+    int time_limit_ms; // 0 searches exactly `depth` with no time limit
+    int threads;
+    bool deterministic;
+    bool quiescence;
+    bool endgame;
+    TranspositionTable table;
+    shared_ptr<const Evaluator> evaluator;
+    shared_ptr<const OpeningBook> book;
+    EndgameSolver solver;
+    vector<Worker> workers; // workers[0] runs on the calling thread
+    atomic<bool> stopped;
+    const atomic<bool> *stop_flag; // set by another thread to end the search early
+    chrono::steady_clock::time_point start, deadline;
+    atomic<int> current_move; // (row + 1) << 16 | (col + 1), updated after every iteration
+    atomic<int> current_depth;
+    long long nodes;
+    int completed_depth;
+    pair<int, int> last_move;
+    static const uint64_t SIDE_TO_MOVE_KEY = 0x5851F42D4C957F2DULL;
+    static const int ASPIRATION_WINDOW = 2;
+    static const int QUIESCENCE_PLIES = 4;  // explosions searched past the nominal depth
+    static const int QUIESCENCE_NODES = 64; // node budget per leaf
+    static const int ENDGAME_CELLS = 4;     // solve once a side holds this few cells...
+    static const int ENDGAME_NODES = 50000; // ...within this many nodes
+    static const int ENDGAME_MAX_DEPTH = 16;
+    // The solver gets at most 1/ENDGAME_TIME_SHARE of the time limit
+    static constexpr int ENDGAME_TIME_SHARE = 4;
+
+    void publish(pair<int, int> move, int depth)
+    {
+        current_move = (move.first + 1) << 16 | (move.second + 1);
+        current_depth = depth;
+    }
+
+    // Book move for this position, if the book has a legal one.
+    bool book_move(const Board &b, pair<int, int> &move) const
+    {
+        BookEntry entry;
+        if (!book || !book->probe(b, color, entry))
+            return false;
+        int cols = b.get_cols();
+        if (entry.move >= (uint32_t)(b.get_rows() * cols))
+            return false;
+        move = {(int)entry.move / cols, (int)entry.move % cols};
+        char owner = b.get_color(move.first, move.second);
+        return owner == ' ' || owner == color;
+    }
+
+    // Late game: one side is down to a few cells on a board at least half
+    // full of orbs. Plays a proven win if the solver finds one; with a time
+    // limit it gets a share of it and the search keeps the rest.
+    bool endgame_move(Board &b, pair<int, int> &move)
+    {
+        const Features &f = b.get_features();
+        int cells = b.get_rows() * b.get_cols();
+        if (!endgame || f.cells[0] == 0 || f.cells[1] == 0 || min(f.cells[0], f.cells[1]) > ENDGAME_CELLS ||
+            2 * (f.orbs[0] + f.orbs[1]) < cells)
+            return false;
+        auto until = time_limit_ms > 0 ? start + chrono::milliseconds(time_limit_ms) / ENDGAME_TIME_SHARE
+                                       : chrono::steady_clock::time_point::max();
+        int result = solver.solve(b, color, ENDGAME_NODES, ENDGAME_MAX_DEPTH, move, until, stop_flag);
+        nodes += solver.get_nodes();
+        return result == 1;
+    }
+
+    // Lazy SMP: helpers run their own iterative deepening on a copy of the
+    // board, one ply ahead every other thread and with the root moves
+    // rotated, and help only by filling the shared table. The move played
+    // is always the one found by workers[0].
+    pair<int, int> search_shared(Board &b, vector<pair<int, int>> &moves, int pv_move)
+    {
+        vector<thread> helpers;
+        for (int i = 1; i < threads; i++)
+        {
+            helpers.emplace_back([this, i, local = b, moves, pv_move]() mutable
+                                 {
+                                     rotate(moves.begin(), moves.begin() + i % moves.size(), moves.end());
+                                     pair<int, int> unused;
+                                     workers[i].deepen(local, moves, 1 + i % 2, pv_move, unused); });
+        }
+        auto bestMove = moves[0];
+        completed_depth = workers[0].deepen(b, moves, 1, pv_move, bestMove);
+        stopped = true;
+        for (auto &helper : helpers)
+            helper.join();
+        return bestMove;
+    }
+
+    // Deterministic mode: every iteration splits the root moves over the
+    // threads and the table only answers for exactly the searched depth, so
+    // the move at a fixed depth does not depend on thread count or timing.
+    // Ties go to the first move in board order.
+    pair<int, int> search_deterministic(Board &b, const vector<pair<int, int>> &moves)
+    {
+        auto bestMove = moves[0];
+        for (int d = 1; d <= depth; d++)
+        {
+            atomic<int> next(0), best(INT_MIN);
+            vector<int> scores(moves.size(), INT_MIN);
+            vector<thread> helpers;
+            for (int i = 1; i < threads; i++)
+            {
+                helpers.emplace_back([this, i, local = b, &moves, d, &next, &best, &scores]() mutable
+                                     {
+                                         workers[i].search_split(local, moves, d, next, best, scores); });
+            }
+            workers[0].search_split(b, moves, d, next, best, scores);
+            for (auto &helper : helpers)
+                helper.join();
+            if (stopped)
+                break;
+            for (int i = 0; i < (int)moves.size(); i++)
+            {
+                if (scores[i] == best)
+                {
+                    bestMove = moves[i];
+                    break;
+                }
+            }
+            completed_depth = d;
+            publish(bestMove, d);
+            auto elapsed = chrono::steady_clock::now() - start;
+            if (time_limit_ms > 0 && elapsed * 2 > chrono::milliseconds(time_limit_ms))
+                break;
         }
+        return bestMove;
     }
 
 public:
-    AI(char color, int depth = 4)
+    AI(char color, int depth = 4, int time_limit_ms = 0)
     {
         this->color = color;
         this->depth = depth;
+        this->time_limit_ms = time_limit_ms;
+        threads = 1;
+        deterministic = false;
+        quiescence = true;
+        endgame = true;
+        nodes = 0;
+        completed_depth = 0;
+        last_move = {-1, -1};
+        stopped = false;
+        stop_flag = nullptr;
+        publish({-1, -1}, 0);
+        evaluator = make_shared<FeatureEvaluator>();
+    }
+
+    // number of positions visited by the last make_move
+    long long get_nodes() const { return nodes; }
+    // deepest iteration the last make_move finished
+    int get_completed_depth() const { return completed_depth; }
+    // the move played by the last make_move
+    pair<int, int> get_last_move() const { return last_move; }
+
+    // With a limit, make_move deepens one ply at a time up to `depth` and
+    // plays the best move of the last iteration that finished in time.
+    void set_time_limit(int ms) { time_limit_ms = ms; }
+    void set_threads(int count) { threads = max(1, count); }
+    void set_deterministic(bool on) { deterministic = on; }
+    // Search capturing explosions past the depth limit (on by default).
+    void set_quiescence(bool on) { quiescence = on; }
+    // Prove late-game positions exactly before searching (on by default).
+    void set_endgame(bool on) { endgame = on; }
+    // Moves in the book are played without searching.
+    void set_book(shared_ptr<const OpeningBook> b) { book = b; }
+    // Table scores from another evaluator mean nothing, so this clears it.
+    void set_evaluator(shared_ptr<const Evaluator> e)
+    {
+        evaluator = e;
+        table.clear();
     }
 
-    bool make_move(Board &b, int row = 0, int col = 0) override
+    // For searches run on another thread: make_move returns early with the
+    // best move so far once *flag is true, and the getters below can be
+    // polled meanwhile to follow the search.
+    void set_stop_flag(const atomic<bool> *flag) { stop_flag = flag; }
+    pair<int, int> get_current_move() const
     {
-        int bestScore = INT_MIN;
+        int move = current_move;
+        return {(move >> 16) - 1, (move & 0xFFFF) - 1};
+    }
+    int get_current_depth() const { return current_depth; }
+    void clear_progress() { publish({-1, -1}, 0); }
+
+    bool make_move(Board &b, int /* row */ = 0, int /* col */ = 0) override
+    {
+        start = chrono::steady_clock::now();
+        publish({-1, -1}, 0);
         auto moves = b.get_valid_moves(color);
         if (moves.empty())
         {
             return false;
         }
-        auto bestMove = moves[0];
+        publish(moves[0], 0);
+        nodes = 0;
+        completed_depth = 0;
+        pair<int, int> bestMove;
+        if (book_move(b, bestMove) || endgame_move(b, bestMove))
+        {
+            publish(bestMove, 0);
+            last_move = bestMove;
+            b.insert_orb(bestMove.first, bestMove.second, color);
+            return true;
+        }
+
+        int cells = b.get_rows() * b.get_cols();
+        if ((int)workers.size() != threads)
+            workers.resize(threads);
+        for (auto &worker : workers)
+        {
+            worker.ai = this;
+            worker.exact_depth = deterministic;
+            worker.reset(depth, cells);
+        }
+        stopped = false;
+        deadline = start + chrono::milliseconds(time_limit_ms);
+
+        if (deterministic)
+            bestMove = search_deterministic(b, moves);
+        else
+        {
+            TTEntry entry;
+            int pv_move = table.probe(b.get_hash(), entry) ? entry.move : -1;
+            bestMove = search_shared(b, moves, pv_move);
+        }
+
+        for (auto &worker : workers)
+            nodes += worker.nodes;
+        last_move = bestMove;
+        b.insert_orb(bestMove.first, bestMove.second, color);
+        return true;
+    }
+};
+
+class MCTS : public player
+{
+    // Children of a node sit next to each other in the pool, so a node only
+    // needs the index of its first child.
+    struct Node
+    {
+        uint64_t hash;    // position after `move`, 0 until first visited
+        float wins;       // playout rewards for the player who made `move`
+        int visits;       // counted on the way down, so in-flight playouts act as virtual losses
+        int first_child;  // -1 until expanded
+        short child_count;
+        short move;       // row * cols + col, -1 at the root
+        signed char proven; // +1 / -1: the player who made `move` can force a win / loss
+    };
+
+    char color;
+    int playouts;
+    int time_limit_ms; // 0 stops on the playout count alone
+    int threads;
+    vector<Node> pool, spare;
+    int root;
+    int played; // node of our last move, to pick the tree up again next turn
+    pair<int, int> last_move;
+    mutex tree_mutex;
+    int started, finished;
+    chrono::steady_clock::time_point deadline;
+    static const int MAX_NODES = 1 << 21;
+    static const int EXPAND_AFTER = 2;   // visits before a leaf gets children
+    static const int MAX_PLAYOUT_MOVES = 6; // then the orb difference decides
+    static const int PLAYOUT_SAMPLES = 4;   // playable cells looked at per playout move
+    constexpr static double EXPLORATION = 1.0;
+    constexpr static float ORB_SCALE = 4.0f;
+
+    static char other(char c) { return c == 'R' ? 'B' : 'R'; }
+
+    int select_child(int node)
+    {
+        const Node &parent = pool[node];
+        double log_visits = log((double)parent.visits + 1);
+        int best = parent.first_child;
+        double best_value = -1;
+        for (int i = parent.first_child; i < parent.first_child + parent.child_count; i++)
+        {
+            const Node &child = pool[i];
+            if (child.proven > 0)
+                return i;
+            if (child.proven < 0)
+                continue;
+            if (child.visits == 0)
+                return i;
+            double value = child.wins / child.visits + EXPLORATION * sqrt(log_visits / child.visits);
+            if (value > best_value)
+            {
+                best_value = value;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    void expand(int node, const Board &board, char to_move, vector<pair<int, int>> &moves, mt19937 &rng)
+    {
+        board.get_valid_moves(to_move, moves);
+        if (moves.empty() || (int)(pool.size() + moves.size()) > MAX_NODES)
+            return;
+        shuffle(moves.begin(), moves.end(), rng);
+        pool[node].first_child = pool.size();
+        pool[node].child_count = moves.size();
         for (auto move : moves)
+            pool.push_back({0, 0, 0, -1, 0, (short)(move.first * board.get_cols() + move.second), 0});
+    }
+
+    // How much a playout wants to play `cell`: loaded cells of our own that
+    // will explode into enemy cells first, then corners, then anything.
+    static int playout_priority(const Board &board, int row, int col, char to_move)
+    {
+        char owner = board.get_color(row, col);
+        int count = board.get_orb_count(row, col);
+        if (owner == to_move && count == board.get_critical_mass(row, col) - 1)
         {
-            auto r = move.first;
-            auto c = move.second;
-            Board temp = b;
-            temp.insert_orb(r, c, color);
-            int score = minimax(temp, this->depth, INT_MIN, INT_MAX, false, color);
-            if (score > bestScore)
+            int enemies = 0;
+            int dx[4] = {-1, 0, 1, 0};
+            int dy[4] = {0, 1, 0, -1};
+            for (int i = 0; i < 4; i++)
+                enemies += board.get_color(row + dx[i], col + dy[i]) == other(to_move);
+            return 2 + enemies;
+        }
+        return owner == ' ' && board.is_corner(row, col) ? 1 : 0;
+    }
+
+    // Plays semi-random moves until the game ends or MAX_PLAYOUT_MOVES and
+    // returns Red's reward: 1 or 0 for a finished game, otherwise a squashed
+    // orb difference.
+    float playout(Board &board, char to_move, mt19937 &rng, vector<pair<int, int>> &moves)
+    {
+        int rows = board.get_rows(), cols = board.get_cols();
+        for (int i = 0; i < MAX_PLAYOUT_MOVES && !board.is_game_over(); i++)
+        {
+            // most cells are playable, so sampling a few beats listing the moves;
+            // keep sampling a little longer if none of them was playable
+            int best = -1, best_priority = -1;
+            for (int tries = 0; tries < 16 && (tries < PLAYOUT_SAMPLES || best < 0); tries++)
             {
-                bestScore = score;
-                bestMove = {r, c};
+                int cell = rng() % (rows * cols);
+                char owner = board.get_color(cell / cols, cell % cols);
+                if (owner != ' ' && owner != to_move)
+                    continue;
+                int priority = playout_priority(board, cell / cols, cell % cols, to_move);
+                if (priority > best_priority)
+                {
+                    best = cell;
+                    best_priority = priority;
+                }
+            }
+            if (best < 0)
+            {
+                board.get_valid_moves(to_move, moves);
+                if (moves.empty())
+                    break;
+                auto move = moves[rng() % moves.size()];
+                best = move.first * cols + move.second;
             }
+            board.insert_orb(best / cols, best % cols, to_move);
+            to_move = other(to_move);
         }
-        b.insert_orb(bestMove.first, bestMove.second, color);
+        int red = board.get_score('R'), blue = board.get_score('B');
+        if (board.is_game_over())
+            return red > blue ? 1.0f : 0.0f;
+        return 0.5f + 0.5f * tanh((red - blue) / ORB_SCALE);
+    }
+
+    bool budget_left()
+    {
+        if (started >= playouts)
+            return false;
+        return time_limit_ms <= 0 || chrono::steady_clock::now() < deadline;
+    }
+
+    // One thread's share of the search. The tree is only touched under
+    // tree_mutex; playouts run outside it on the thread's own board.
+    void search(const Board &root_board, unsigned seed)
+    {
+        mt19937 rng(seed);
+        Board board = root_board;
+        vector<pair<int, int>> moves;
+        vector<int> path;
+        int cols = root_board.get_cols();
+        while (true)
+        {
+            board = root_board;
+            path.clear();
+            char to_move = color;
+            int leaf_proven; // read under the lock: other threads prove nodes
+            {
+                lock_guard<mutex> lock(tree_mutex);
+                if (!budget_left())
+                    break;
+                started++;
+                int node = root;
+                pool[node].visits++;
+                path.push_back(node);
+                while (!board.is_game_over() && pool[node].proven == 0)
+                {
+                    if (pool[node].first_child < 0)
+                    {
+                        if (pool[node].visits < EXPAND_AFTER)
+                            break;
+                        expand(node, board, to_move, moves, rng);
+                        if (pool[node].first_child < 0)
+                            break;
+                    }
+                    node = select_child(node);
+                    board.insert_orb(pool[node].move / cols, pool[node].move % cols, to_move);
+                    if (pool[node].hash == 0)
+                        pool[node].hash = board.get_hash();
+                    // a move that ends the game wins it, since a cascade
+                    // only ever spreads the mover's color
+                    if (board.is_game_over())
+                        pool[node].proven = 1;
+                    to_move = other(to_move);
+                    pool[node].visits++;
+                    path.push_back(node);
+                    if (pool[node].visits == 1)
+                        break;
+                }
+                leaf_proven = pool[node].proven;
+            }
+
+            // proven positions need no playout
+            float red_reward;
+            char leaf_mover = path.size() % 2 == 0 ? color : other(color);
+            if (path.size() > 1 && leaf_proven != 0)
+                red_reward = (leaf_proven > 0) == (leaf_mover == 'R') ? 1.0f : 0.0f;
+            else
+                red_reward = playout(board, to_move, rng, moves);
+
+            lock_guard<mutex> lock(tree_mutex);
+            // path[k] was entered by a move of `color` when k is odd
+            for (int k = 1; k < (int)path.size(); k++)
+            {
+                char mover = k % 2 == 1 ? color : other(color);
+                pool[path[k]].wins += mover == 'R' ? red_reward : 1.0f - red_reward;
+            }
+            prove(path);
+            finished++;
+        }
+    }
+
+    // MCTS-Solver: a node whose child is a forced win for the opponent is a
+    // forced loss, and one whose children are all forced losses for the
+    // opponent is a forced win.
+    void prove(const vector<int> &path)
+    {
+        for (int k = (int)path.size() - 1; k > 1; k--)
+        {
+            Node &child = pool[path[k]];
+            Node &parent = pool[path[k - 1]];
+            if (parent.proven != 0 || child.proven == 0)
+                return;
+            if (child.proven > 0)
+                parent.proven = -1;
+            else
+            {
+                for (int i = parent.first_child; i < parent.first_child + parent.child_count; i++)
+                    if (pool[i].proven >= 0)
+                        return;
+                parent.proven = 1;
+            }
+        }
+    }
+
+    // Copies the subtree under `node` to the front of the spare pool, keeping
+    // children contiguous, and makes it the whole tree.
+    void reroot(int node)
+    {
+        spare.clear();
+        spare.push_back(pool[node]);
+        spare[0].move = -1;
+        spare[0].proven = 0;
+        for (size_t i = 0; i < spare.size(); i++)
+        {
+            int first = spare[i].first_child;
+            if (first < 0)
+                continue;
+            spare[i].first_child = spare.size();
+            for (int k = 0; k < spare[i].child_count; k++)
+                spare.push_back(pool[first + k]);
+        }
+        swap(pool, spare);
+        root = 0;
+    }
+
+    // Finds the current position among the replies to our last move.
+    void reuse_tree(const Board &b)
+    {
+        int found = -1;
+        if (played >= 0 && pool[played].first_child >= 0)
+        {
+            const Node &last = pool[played];
+            for (int i = last.first_child; i < last.first_child + last.child_count; i++)
+                if (pool[i].hash == b.get_hash())
+                    found = i;
+        }
+        if (found >= 0)
+            reroot(found);
+        else
+        {
+            pool.clear();
+            pool.push_back({b.get_hash(), 0, 0, -1, 0, -1, 0});
+            root = 0;
+        }
+        played = -1;
+    }
+
+public:
+    MCTS(char color, int playouts = 10000, int time_limit_ms = 0, int threads = 1)
+    {
+        this->color = color;
+        this->playouts = playouts;
+        this->time_limit_ms = time_limit_ms;
+        this->threads = max(1, threads);
+        root = 0;
+        played = -1;
+        last_move = {-1, -1};
+        started = finished = 0;
+    }
+
+    // playouts finished by the last make_move
+    int get_playouts() const { return finished; }
+    int get_tree_size() const { return pool.size(); }
+    // the move played by the last make_move
+    pair<int, int> get_last_move() const { return last_move; }
+
+    bool make_move(Board &b, int /* row */ = 0, int /* col */ = 0) override
+    {
+        if (b.get_valid_moves(color).empty())
+            return false;
+        deadline = chrono::steady_clock::now() + chrono::milliseconds(time_limit_ms);
+        if (pool.capacity() < (size_t)MAX_NODES)
+        {
+            pool.reserve(MAX_NODES);
+            spare.reserve(MAX_NODES);
+        }
+        reuse_tree(b);
+        started = finished = 0;
+
+        vector<thread> helpers;
+        for (int i = 1; i < threads; i++)
+            helpers.emplace_back([this, &b, i]()
+                                 { search(b, 7919u * i + (unsigned)b.get_hash()); });
+        search(b, (unsigned)b.get_hash());
+        for (auto &helper : helpers)
+            helper.join();
+
+        // a tiny budget can end before the root has children
+        if (pool[root].first_child < 0)
+        {
+            vector<pair<int, int>> moves;
+            mt19937 rng(0);
+            expand(root, b, color, moves, rng);
+        }
+        // a proven win, else the most visited move not proven to lose
+        int first = pool[root].first_child;
+        int best = first;
+        for (int i = first; i < first + pool[root].child_count; i++)
+        {
+            const Node &child = pool[i], &current = pool[best];
+            if (current.proven > 0)
+                break;
+            if (child.proven > 0 || (current.proven < 0 && child.proven >= 0) ||
+                (child.proven == 0 && child.visits > current.visits))
+                best = i;
+        }
+        played = best;
+        int cols = b.get_cols();
+        last_move = {pool[best].move / cols, pool[best].move % cols};
+        b.insert_orb(pool[best].move / cols, pool[best].move % cols, color);
         return true;
     }
 };
@@ -0,0 +1,66 @@
+#ifndef SEARCH_TASK_HPP
+#define SEARCH_TASK_HPP
+
+#include <atomic>
+#include <thread>
+#include "board.hpp"
+#include "player.hpp"
+using namespace std;
+
+// Runs AI::make_move on a copy of the board in a background thread, so the
+// caller (the UI, the engine server) stays responsive and can poll the
+// search or cancel it. The AI must not be used elsewhere until the task is
+// finished; the caller applies the returned move to its own board.
+class SearchTask
+{
+    AI &ai;
+    Board board;
+    atomic<bool> cancelled;
+    atomic<bool> finished;
+    bool found;
+    thread worker;
+
+public:
+    SearchTask(AI &ai, const Board &b, int time_limit_ms) : ai(ai), board(b)
+    {
+        cancelled = false;
+        finished = false;
+        found = false;
+        ai.set_time_limit(time_limit_ms);
+        ai.set_stop_flag(&cancelled);
+        ai.clear_progress();
+        worker = thread([this]()
+                        {
+                            found = this->ai.make_move(board);
+                            finished = true; });
+    }
+
+    SearchTask(const SearchTask &) = delete;
+    SearchTask &operator=(const SearchTask &) = delete;
+
+    ~SearchTask()
+    {
+        cancel();
+        wait();
+    }
+
+    bool done() const { return finished; }
+    // ends the search at the next check; it still settles on a move
+    void cancel() { cancelled = true; }
+    // best move of the deepest iteration finished so far, final once done()
+    pair<int, int> best_move() const { return ai.get_current_move(); }
+    int depth() const { return ai.get_current_depth(); }
+
+    // Blocks until the search ends. False if the side had no legal move.
+    bool wait()
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+            ai.set_stop_flag(nullptr);
+        }
+        return found;
+    }
+};
+
+#endif
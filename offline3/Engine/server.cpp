@@ -0,0 +1,217 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <cctype>
+#include "board.hpp"
+#include "player.hpp"
+#include "search_task.hpp"
+
+using namespace std;
+
+// Long-lived engine process for the UI. It keeps the game position and
+// the AI players (with their transposition tables) between moves. Each
+// command is one line on stdin and gets exactly one line back on stdout.
+//
+//   new <rows> <cols>                  empty board        -> board ...
+//   position <rows> <cols> <cell>...   load a position    -> board ...
+//   play <row> <col> <color>           apply a move       -> board ... | error ...
+//   go <color> <depth> <time_ms>       start a search     -> searching | error ...
+//   poll                               progress           -> info <depth> <row> <col> | bestmove <row> <col>
+//   wait                               finish the search  -> bestmove <row> <col>
+//   stop                               cut it short       -> bestmove <row> <col>
+//   board                                                 -> board ...
+//   quit
+//
+// The search runs in the background so the UI can keep polling; its move
+// is played on the board when bestmove is reported. new, position, play
+// and go answer "error busy" while a search is running.
+//
+// Cells are row-major, "0" for an empty cell or "<count><color>" (e.g. 2R),
+// as the UI used to write them to gamestate.txt. A count must be below the
+// cell's critical mass, and a board holds at most MAX_BOARD_CELLS cells:
+//
+//   board <rows> <cols> <over> <cell>...   over is 1 once the game has ended
+
+string board_line(Board &board)
+{
+    string line = "board " + to_string(board.get_rows()) + " " + to_string(board.get_cols()) +
+                  " " + (board.is_game_over() ? "1" : "0");
+    for (int i = 0; i < board.get_rows(); i++)
+        for (int j = 0; j < board.get_cols(); j++)
+        {
+            char color = board.get_color(i, j);
+            if (color == ' ')
+                line += " 0";
+            else
+                line += " " + to_string(board.get_orb_count(i, j)) + color;
+        }
+    return line;
+}
+
+bool valid_color(char color) { return color == 'R' || color == 'B'; }
+
+bool valid_size(int rows, int cols)
+{
+    return rows >= 2 && cols >= 2 && (long long)rows * cols <= MAX_BOARD_CELLS;
+}
+
+// Reads a "<count><color>" cell. The count must leave the cell short of
+// its critical mass, as in any position reached by play.
+bool parse_cell(const string &cell, int critical, int &count, char &color)
+{
+    if (cell.size() < 2 || cell.size() > 3 || !valid_color(cell.back()))
+        return false;
+    count = 0;
+    for (size_t k = 0; k + 1 < cell.size(); k++)
+    {
+        if (!isdigit((unsigned char)cell[k]))
+            return false;
+        count = count * 10 + (cell[k] - '0');
+    }
+    color = cell.back();
+    return count >= 1 && count < critical;
+}
+
+// Ends the search, plays its move and returns the reply.
+string finish_search(unique_ptr<SearchTask> &task, char color, Board &board)
+{
+    bool found = task->wait();
+    auto move = task->best_move();
+    task.reset();
+    if (!found)
+        return "error no moves";
+    board.insert_orb(move.first, move.second, color);
+    return "bestmove " + to_string(move.first) + " " + to_string(move.second);
+}
+
+int main(int argc, char *argv[])
+{
+    ios::sync_with_stdio(false);
+    Board board(5, 6);
+    // engine_server [book file]
+    shared_ptr<const OpeningBook> book;
+    if (argc > 1)
+        book = make_shared<OpeningBook>(argv[1]);
+    unique_ptr<AI> players[2]; // kept across moves so their tables stay warm
+    int depths[2] = {0, 0};
+    unique_ptr<SearchTask> task;
+    char task_color = ' ';
+
+    string line;
+    while (getline(cin, line))
+    {
+        stringstream ss(line);
+        string command;
+        ss >> command;
+        string reply;
+
+        bool searching = task != nullptr;
+        if (searching && (command == "new" || command == "position" || command == "play" || command == "go"))
+            reply = "error busy";
+        else if (command == "new" || command == "position")
+        {
+            int rows, cols;
+            if (!(ss >> rows >> cols) || !valid_size(rows, cols))
+                reply = "error bad size";
+            else
+            {
+                // the current board stays as it was if a cell is bad
+                Board loaded(rows, cols);
+                string cell;
+                for (int i = 0; i < rows * cols && command == "position" && ss >> cell; i++)
+                {
+                    int count;
+                    char color;
+                    if (cell == "0")
+                        continue;
+                    if (!parse_cell(cell, loaded.get_critical_mass(i / cols, i % cols), count, color))
+                    {
+                        reply = "error bad cell " + cell;
+                        break;
+                    }
+                    loaded.set_cell(i / cols, i % cols, count, color);
+                }
+                if (reply.empty())
+                {
+                    // Zobrist keys ignore the board size, so table entries
+                    // from another size would match the wrong positions
+                    if (rows != board.get_rows() || cols != board.get_cols())
+                    {
+                        players[0].reset();
+                        players[1].reset();
+                    }
+                    board = loaded;
+                    reply = board_line(board);
+                }
+            }
+        }
+        else if (command == "play")
+        {
+            int row, col;
+            char color;
+            if (!(ss >> row >> col >> color) || !valid_color(color) || row < 0 || row >= board.get_rows() ||
+                col < 0 || col >= board.get_cols())
+                reply = "error bad move";
+            else if (!board.insert_orb(row, col, color))
+                reply = "error cell taken";
+            else
+                reply = board_line(board);
+        }
+        else if (command == "go")
+        {
+            char color = ' ';
+            int depth = 3, time_ms = 0;
+            ss >> color >> depth >> time_ms;
+            if (!valid_color(color))
+                reply = "error bad color";
+            else
+            {
+                int side = color == 'R' ? 0 : 1;
+                if (!players[side] || depths[side] != depth)
+                {
+                    players[side].reset(new AI(color, depth));
+                    players[side]->set_book(book);
+                    depths[side] = depth;
+                }
+                if (board.get_valid_moves(color).empty())
+                    reply = "error no moves";
+                else
+                {
+                    task.reset(new SearchTask(*players[side], board, time_ms));
+                    task_color = color;
+                    reply = "searching";
+                }
+            }
+        }
+        else if (command == "poll" || command == "wait" || command == "stop")
+        {
+            if (!searching)
+                reply = "error not searching";
+            else if (command == "poll" && !task->done())
+            {
+                auto move = task->best_move();
+                reply = "info " + to_string(task->depth()) + " " + to_string(move.first) + " " +
+                        to_string(move.second);
+            }
+            else
+            {
+                if (command == "stop")
+                    task->cancel();
+                reply = finish_search(task, task_color, board);
+            }
+        }
+        else if (command == "board")
+            reply = board_line(board);
+        else if (command == "quit")
+            break;
+        else if (command.empty())
+            continue;
+        else
+            reply = "error unknown command " + command;
+
+        cout << reply << '\n'
+             << flush;
+    }
+    return 0;
+}
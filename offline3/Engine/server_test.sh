@@ -0,0 +1,18 @@
+#!/bin/sh
+# server_test.sh <engine_server>: a search after the board changes size
+# must find the move a fresh server finds. Zobrist keys ignore the size, so
+# the two positions below share a hash and stale table entries would be hit.
+server=${1:-./engine_server}
+small="position 5 6 1R 1B 0 0 0 0 0 1R 0 1B 0 0 0 0 1R 0 0 0 0 0 0 1B 0 0 0 0 0 0 0 0"
+large="position 8 8 1R 1B 0 0 0 0 0 1R 0 1B 0 0 0 0 1R 0 0 0 0 0 0 1B $(printf '0 %.0s' $(seq 40))"
+status=0
+for depth in 4 5 6; do
+    switched=$(printf '%s\ngo R %s 0\nwait\n%s\ngo R %s 0\nwait\nquit\n' "$small" $depth "$large" $depth | "$server" | tail -n 1)
+    fresh=$(printf '%s\ngo R %s 0\nwait\nquit\n' "$large" $depth | "$server" | tail -n 1)
+    if [ "$switched" != "$fresh" ]; then
+        echo "depth $depth: '$switched' after a size change, '$fresh' on a fresh server"
+        status=1
+    fi
+done
+[ $status -eq 0 ] && echo "server keeps no table entries across board sizes"
+exit $status
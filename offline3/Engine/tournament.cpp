@@ -0,0 +1,342 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include "board.hpp"
+#include "player.hpp"
+
+using namespace std;
+
+// Self-play tournament between two engines. Games run in parallel, each
+// opening is played twice with colours swapped, and the report gives the
+// score of A against B with a 95% confidence interval plus search speed
+// and move latency for both.
+//
+//   tournament [options] <player A> <player B>
+//
+//   player:  ai:depth=3,time=0,threads=1,eval=features,qs=1,eg=1,book=<file>
+//            mcts:playouts=2000,time=0,threads=1
+//   -g N     games (default 100, rounded up to an even number)
+//   -j N     games played at once (default: hardware threads)
+//   -b RxC   board sizes, comma separated, used in turn (default 5x6)
+//   -o N     random plies before the engines take over (default 4)
+//   -m N     moves before a game is called a draw (default 1000)
+//   -s N     seed for the openings (default 1)
+
+struct PlayerSpec
+{
+    string text;
+    string kind; // "ai" or "mcts"
+    int depth = 3;
+    int playouts = 2000;
+    int time_ms = 0;
+    int threads = 1;
+    string eval = "features";
+    bool quiescence = true;
+    bool endgame = true;
+    shared_ptr<const OpeningBook> book;
+
+    unique_ptr<player> create(char color) const
+    {
+        if (kind == "mcts")
+            return unique_ptr<player>(new MCTS(color, playouts, time_ms, threads));
+        AI *ai = new AI(color, depth, time_ms);
+        ai->set_threads(threads);
+        ai->set_quiescence(quiescence);
+        ai->set_endgame(endgame);
+        ai->set_book(book);
+        if (eval == "orbs")
+            ai->set_evaluator(make_shared<OrbEvaluator>());
+        return unique_ptr<player>(ai);
+    }
+};
+
+bool parse_player(const string &text, PlayerSpec &spec)
+{
+    spec.text = text;
+    size_t colon = text.find(':');
+    spec.kind = text.substr(0, colon);
+    if (spec.kind != "ai" && spec.kind != "mcts")
+        return false;
+    if (colon == string::npos)
+        return true;
+    stringstream ss(text.substr(colon + 1));
+    string option;
+    while (getline(ss, option, ','))
+    {
+        size_t eq = option.find('=');
+        if (eq == string::npos)
+            return false;
+        string key = option.substr(0, eq);
+        if (key == "book")
+        {
+            spec.book = make_shared<OpeningBook>(option.substr(eq + 1));
+            if (spec.book->size() == 0)
+                return false;
+            continue;
+        }
+        if (key == "eval")
+        {
+            spec.eval = option.substr(eq + 1);
+            if (spec.eval != "features" && spec.eval != "orbs")
+                return false;
+            continue;
+        }
+        int value = atoi(option.c_str() + eq + 1);
+        if (key == "depth")
+            spec.depth = value;
+        else if (key == "playouts")
+            spec.playouts = value;
+        else if (key == "time")
+            spec.time_ms = value;
+        else if (key == "threads")
+            spec.threads = value;
+        else if (key == "qs")
+            spec.quiescence = value != 0;
+        else if (key == "eg")
+            spec.endgame = value != 0;
+        else
+            return false;
+    }
+    return true;
+}
+
+// Totals for one player, merged from all games
+struct PlayerStats
+{
+    int wins = 0, losses = 0, draws = 0;
+    long long work = 0; // nodes for ai, playouts for mcts
+    double seconds = 0;
+    vector<double> latencies_ms;
+
+    void merge(const PlayerStats &other)
+    {
+        wins += other.wins;
+        losses += other.losses;
+        draws += other.draws;
+        work += other.work;
+        seconds += other.seconds;
+        latencies_ms.insert(latencies_ms.end(), other.latencies_ms.begin(), other.latencies_ms.end());
+    }
+};
+
+long long work_done(player *p)
+{
+    if (AI *ai = dynamic_cast<AI *>(p))
+        return ai->get_nodes();
+    if (MCTS *mcts = dynamic_cast<MCTS *>(p))
+        return mcts->get_playouts();
+    return 0;
+}
+
+// Random legal plies from an empty board, redrawn if they end the game
+Board random_opening(int rows, int cols, int plies, mt19937 &rng)
+{
+    while (true)
+    {
+        Board board(rows, cols);
+        char color = 'R';
+        bool over = false;
+        for (int i = 0; i < plies && !over; i++)
+        {
+            auto moves = board.get_valid_moves(color);
+            auto move = moves[rng() % moves.size()];
+            board.insert_orb(move.first, move.second, color);
+            over = board.is_game_over();
+            color = color == 'R' ? 'B' : 'R';
+        }
+        if (!over)
+            return board;
+    }
+}
+
+// Plays one game with A as `a_color`; returns 0 if A won, 1 if B won, 2 for a draw
+int play_game(const PlayerSpec specs[2], char a_color, Board board, int plies, int max_moves, PlayerStats stats[2])
+{
+    char b_color = a_color == 'R' ? 'B' : 'R';
+    unique_ptr<player> players[2] = {specs[0].create(a_color), specs[1].create(b_color)};
+    char color = plies % 2 == 0 ? 'R' : 'B';
+    for (int move = 0; move < max_moves; move++)
+    {
+        int side = color == a_color ? 0 : 1;
+        auto start = chrono::steady_clock::now();
+        if (!players[side]->make_move(board, 0, 0))
+            return 1 - side;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        stats[side].seconds += seconds;
+        stats[side].latencies_ms.push_back(seconds * 1000);
+        stats[side].work += work_done(players[side].get());
+        if (board.is_game_over())
+            return side;
+        color = color == 'R' ? 'B' : 'R';
+    }
+    return 2;
+}
+
+string format_rate(double per_second)
+{
+    stringstream ss;
+    ss << fixed << setprecision(1);
+    if (per_second >= 1e6)
+        ss << per_second / 1e6 << "M";
+    else if (per_second >= 1e3)
+        ss << per_second / 1e3 << "k";
+    else
+        ss << per_second;
+    return ss.str();
+}
+
+void usage()
+{
+    cerr << "usage: tournament [-g games] [-j jobs] [-b RxC[,RxC...]] [-o plies] [-m max_moves] [-s seed] "
+            "<player A> <player B>\n"
+            "  player: ai:depth=3,time=0,threads=1,eval=features|orbs,qs=1|0,eg=1|0,book=<file> | mcts:playouts=2000,time=0,threads=1\n";
+}
+
+int main(int argc, char *argv[])
+{
+    int games = 100, jobs = max(1u, thread::hardware_concurrency()), plies = 4, max_moves = 1000;
+    unsigned seed = 1;
+    vector<pair<int, int>> sizes;
+    vector<string> names;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc)
+        {
+            string value = argv[++i];
+            if (arg == "-g")
+                games = atoi(value.c_str());
+            else if (arg == "-j")
+                jobs = max(1, atoi(value.c_str()));
+            else if (arg == "-o")
+                plies = max(0, atoi(value.c_str()));
+            else if (arg == "-m")
+                max_moves = atoi(value.c_str());
+            else if (arg == "-s")
+                seed = atoi(value.c_str());
+            else if (arg == "-b")
+            {
+                stringstream ss(value);
+                string size;
+                while (getline(ss, size, ','))
+                {
+                    int rows = 0, cols = 0;
+                    if (sscanf(size.c_str(), "%dx%d", &rows, &cols) != 2 || rows < 2 || cols < 2)
+                    {
+                        cerr << "bad board size " << size << "\n";
+                        return 1;
+                    }
+                    sizes.push_back({rows, cols});
+                }
+            }
+            else
+            {
+                usage();
+                return 1;
+            }
+        }
+        else
+            names.push_back(arg);
+    }
+    PlayerSpec specs[2];
+    if (names.size() != 2 || !parse_player(names[0], specs[0]) || !parse_player(names[1], specs[1]))
+    {
+        usage();
+        return 1;
+    }
+    if (sizes.empty())
+        sizes.push_back({5, 6});
+    int pairs = (max(1, games) + 1) / 2;
+
+    // each job takes the next pair of games: same opening, colours swapped
+    atomic<int> next(0), finished(0);
+    mutex stats_mutex;
+    PlayerStats totals[2];
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int j = 0; j < jobs; j++)
+    {
+        workers.emplace_back([&]()
+                             {
+            for (int p = next++; p < pairs; p = next++)
+            {
+                auto size = sizes[p % sizes.size()];
+                mt19937 rng(seed * 1000003u + p);
+                Board opening = random_opening(size.first, size.second, plies, rng);
+                PlayerStats stats[2];
+                for (char a_color : {'R', 'B'})
+                {
+                    int result = play_game(specs, a_color, opening, plies, max_moves, stats);
+                    if (result == 2)
+                    {
+                        stats[0].draws++;
+                        stats[1].draws++;
+                    }
+                    else
+                    {
+                        stats[result].wins++;
+                        stats[1 - result].losses++;
+                    }
+                }
+                lock_guard<mutex> lock(stats_mutex);
+                totals[0].merge(stats[0]);
+                totals[1].merge(stats[1]);
+                finished += 2;
+                if (finished % max(2, pairs / 5 * 2) == 0)
+                    cerr << finished << "/" << pairs * 2 << " games\n";
+            } });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // A's score per game is 1, 1/2 or 0; the interval is the normal
+    // approximation over those game scores
+    int n = pairs * 2;
+    double score = (totals[0].wins + 0.5 * totals[0].draws) / n;
+    double mean_square = (totals[0].wins + 0.25 * totals[0].draws) / n;
+    double margin = 1.96 * sqrt(max(0.0, mean_square - score * score) / n);
+    double clamped = min(max(score, 0.001), 0.999);
+    double elo = -400 * log10(1 / clamped - 1) + 0.0;
+
+    cout << n << " games, boards";
+    for (auto &size : sizes)
+        cout << " " << size.first << "x" << size.second;
+    cout << ", " << plies << " random plies, " << jobs << " jobs, " << fixed << setprecision(1) << wall << " s\n";
+    cout << "A scores " << setprecision(1) << score * 100 << "% +- " << margin * 100 << "% against B (Elo "
+         << showpos << setprecision(0) << elo << noshowpos << ")\n\n";
+
+    cout << left << setw(4) << "" << setw(34) << "player" << right << setw(6) << "W" << setw(6) << "L" << setw(6)
+         << "D" << setw(12) << "work/s" << setw(10) << "avg ms" << setw(10) << "p99 ms" << "\n";
+    for (int i = 0; i < 2; i++)
+    {
+        auto &latencies = totals[i].latencies_ms;
+        double average = 0, p99 = 0;
+        if (!latencies.empty())
+        {
+            for (double ms : latencies)
+                average += ms;
+            average /= latencies.size();
+            size_t index = min(latencies.size() - 1, (size_t)(latencies.size() * 0.99));
+            nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+            p99 = latencies[index];
+        }
+        double rate = totals[i].seconds > 0 ? totals[i].work / totals[i].seconds : 0;
+        cout << left << setw(4) << (i == 0 ? "A" : "B") << setw(34) << specs[i].text << right << setw(6)
+             << totals[i].wins << setw(6) << totals[i].losses << setw(6) << totals[i].draws << setw(12)
+             << format_rate(rate) << setw(10) << setprecision(2) << average << setw(10) << p99 << "\n";
+    }
+    cout << "(work is nodes for ai and playouts for mcts)\n";
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef TRANSPOSITION_HPP
+#define TRANSPOSITION_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+using namespace std;
+
+enum Bound
+{
+    EXACT,
+    LOWER, // score is at least this (beta cutoff)
+    UPPER  // score is at most this (failed low)
+};
+
+struct TTEntry
+{
+    int score;
+    int depth;
+    Bound bound;
+    int move; // row * cols + col of the best move, -1 if none
+};
+
+class TranspositionTable
+{
+    // A slot keeps (key ^ data, data). Entries are written without locks;
+    // a write torn by another thread fails the key check on probe and is
+    // treated as a miss.
+    struct Slot
+    {
+        atomic<uint64_t> check;
+        atomic<uint64_t> data;
+    };
+
+    unique_ptr<Slot[]> slots;
+    uint64_t mask;
+
+    static uint64_t pack(const TTEntry &entry)
+    {
+        return (uint64_t)(uint32_t)entry.score |
+               ((uint64_t)(entry.depth & 0xFF) << 32) |
+               ((uint64_t)entry.bound << 40) |
+               ((uint64_t)(entry.move + 1) << 48);
+    }
+
+    static TTEntry unpack(uint64_t data)
+    {
+        TTEntry entry;
+        entry.score = (int)(uint32_t)(data & 0xFFFFFFFFULL);
+        entry.depth = (int)((data >> 32) & 0xFF);
+        entry.bound = (Bound)((data >> 40) & 0x3);
+        entry.move = (int)(data >> 48) - 1;
+        return entry;
+    }
+
+public:
+    TranspositionTable(int size_mb = 16)
+    {
+        uint64_t count = 1;
+        while (count * 2 * sizeof(Slot) <= (uint64_t)size_mb << 20)
+            count *= 2;
+        slots.reset(new Slot[count]);
+        mask = count - 1;
+        clear();
+    }
+
+    void clear()
+    {
+        for (uint64_t i = 0; i <= mask; i++)
+        {
+            slots[i].check.store(0, memory_order_relaxed);
+            slots[i].data.store(0, memory_order_relaxed);
+        }
+    }
+
+    bool probe(uint64_t key, TTEntry &entry) const
+    {
+        const Slot &slot = slots[key & mask];
+        uint64_t data = slot.data.load(memory_order_relaxed);
+        if ((slot.check.load(memory_order_relaxed) ^ data) != key || data == 0)
+            return false;
+        entry = unpack(data);
+        return true;
+    }
+
+    // Keeps the deeper result for the same position; a different position
+    // always takes the slot.
+    void store(uint64_t key, const TTEntry &entry)
+    {
+        Slot &slot = slots[key & mask];
+        uint64_t old = slot.data.load(memory_order_relaxed);
+        if ((slot.check.load(memory_order_relaxed) ^ old) == key && unpack(old).depth > entry.depth)
+            return;
+        uint64_t data = pack(entry);
+        slot.check.store(key ^ data, memory_order_relaxed);
+        slot.data.store(data, memory_order_relaxed);
+    }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <cstring>
+#include "board.hpp"
+
+using namespace std;
+
+// Differential test of the wave kernel against the queue cascade. Random
+// crowded positions get the same move three ways: insert_orb, explode and
+// explode_waves. A cascade that leaves both colors on the board must give
+// the same cells, hash and features on all three; one that ends the game
+// must end it with the same winner. The features are also checked against
+// a board rebuilt from the resulting cells, and undo_move must restore the
+// starting position.
+//
+//   wave_test [positions] [seed]
+
+bool same_features(const Features &a, const Features &b)
+{
+    for (int s = 0; s < 2; s++)
+        if (a.orbs[s] != b.orbs[s] || a.cells[s] != b.cells[s] || a.critical[s] != b.critical[s] ||
+            a.corners[s] != b.corners[s] || a.edges[s] != b.edges[s] || a.vulnerable[s] != b.vulnerable[s] ||
+            a.chains[s] != b.chains[s])
+            return false;
+    return true;
+}
+
+bool same_cells(const Board &a, const Board &b)
+{
+    int cells = a.get_rows() * a.get_cols();
+    return memcmp(a.get_counts(), b.get_counts(), cells) == 0 && memcmp(a.get_owners(), b.get_owners(), cells) == 0;
+}
+
+char winner(const Board &b)
+{
+    const Features &f = b.get_features();
+    return f.cells[0] == 0 ? 'B' : f.cells[1] == 0 ? 'R' : ' ';
+}
+
+// Half to seven eighths of the owned cells one orb short of exploding, so
+// cascades are long and insert_orb often takes the wave kernel.
+Board random_position(mt19937 &rng)
+{
+    int rows = 2 + rng() % 11, cols = 2 + rng() % (WAVE_MAX_COLS - 1);
+    int crowding = 2 << rng() % 3;
+    vector<uint8_t> counts(rows * cols);
+    vector<char> owners(rows * cols);
+    for (int i = 0; i < rows * cols; i++)
+    {
+        int critical = critical_mass(i / cols, i % cols, rows, cols);
+        owners[i] = rng() % 4 == 0 ? ' ' : rng() % 2 ? 'R' : 'B';
+        counts[i] = owners[i] == ' ' ? 0 : rng() % crowding ? critical - 1 : 1 + rng() % (critical - 1);
+    }
+    return Board(rows, cols, counts.data(), owners.data());
+}
+
+int main(int argc, char *argv[])
+{
+    int positions = argc > 1 ? atoi(argv[1]) : 20000;
+    mt19937 rng(argc > 2 ? atoi(argv[2]) : 1);
+    int cascades = 0, game_over = 0, failures = 0;
+    for (int n = 0; n < positions; n++)
+    {
+        Board start = random_position(rng);
+        const Features &f = start.get_features();
+        if (f.cells[0] == 0 || f.cells[1] == 0)
+            continue;
+        char color = rng() % 2 ? 'R' : 'B';
+        vector<pair<int, int>> moves;
+        start.get_valid_moves(color, moves);
+        int row = -1, col = -1;
+        for (auto move : moves)
+            if (start.get_orb_count(move.first, move.second) + 1 >= start.get_critical_mass(move.first, move.second))
+            {
+                row = move.first;
+                col = move.second;
+                if (rng() % 4 == 0)
+                    break;
+            }
+        if (row < 0)
+            continue;
+        cascades++;
+
+        Board inserted = start, queued = start, waved = start;
+        inserted.apply_move(row, col, color);
+        queued.explode(row, col, color);
+        waved.explode_waves(row, col, color);
+
+        const char *error = nullptr;
+        if (winner(queued) != ' ')
+        {
+            game_over++;
+            if (winner(waved) != winner(queued) || winner(inserted) != winner(queued))
+                error = "different winner";
+        }
+        else if (!same_cells(queued, waved) || !same_cells(queued, inserted))
+            error = "different cells";
+        else if (queued.get_hash() != waved.get_hash() || queued.get_hash() != inserted.get_hash())
+            error = "different hash";
+        else if (!same_features(queued.get_features(), waved.get_features()) ||
+                 !same_features(queued.get_features(), inserted.get_features()))
+            error = "different features";
+
+        for (const Board *after : {&queued, &waved})
+        {
+            Board rebuilt(after->get_rows(), after->get_cols(), after->get_counts(), after->get_owners());
+            if (!error && !same_features(after->get_features(), rebuilt.get_features()))
+                error = "features differ from a rebuilt board";
+        }
+        inserted.undo_move();
+        if (!error && (!same_cells(inserted, start) || inserted.get_hash() != start.get_hash() ||
+                       !same_features(inserted.get_features(), start.get_features())))
+            error = "undo_move did not restore the position";
+
+        if (error)
+        {
+            failures++;
+            if (failures <= 10)
+                cout << "position " << n << " (" << start.get_rows() << "x" << start.get_cols() << "), " << color
+                     << " at " << row << " " << col << ": " << error << endl;
+        }
+    }
+    cout << cascades << " cascades (" << game_over << " ending the game), " << failures << " failures" << endl;
+    return failures == 0 && cascades > 0 ? 0 : 1;
+}
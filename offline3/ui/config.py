@@ -25,4 +25,7 @@ HOVER_RED = (255, 100, 100)
 # Font sizes
 SMALL_FONT_SIZE = 20
 NORMAL_FONT_SIZE = 24
-TITLE_FONT_SIZE = 48
\ No newline at end of file
+TITLE_FONT_SIZE = 48
+
+# Search depth for each AI difficulty
+AI_DEPTHS = {"Easy": 1, "Normal": 2, "Medium": 3, "Hard": 4}
\ No newline at end of file
@@ -0,0 +1,96 @@
+"""
+Client for the C++ engine process (Engine/build/engine_server)
+Keeps one engine running for the whole session and talks to it over a pipe
+"""
+
+import os
+import subprocess
+
+ENGINE_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Engine", "build", "engine_server")
+
+class EngineError(Exception):
+    pass
+
+class EngineClient:
+    def __init__(self, path=ENGINE_PATH):
+        self.process = subprocess.Popen([path], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                        text=True, bufsize=1)
+
+    def send(self, command):
+        """Send one command line and return the engine's one-line reply"""
+        self.process.stdin.write(command + "\n")
+        self.process.stdin.flush()
+        reply = self.process.stdout.readline().strip()
+        if not reply:
+            raise EngineError("engine exited")
+        if reply.startswith("error"):
+            raise EngineError(reply[6:])
+        return reply
+
+    def parse_board(self, reply):
+        """Turn a 'board ...' reply into (board_data, game_over)"""
+        parts = reply.split()
+        rows, cols, over = int(parts[1]), int(parts[2]), parts[3] == "1"
+        cells = parts[4:]
+        board_data = []
+        for i in range(rows):
+            row = []
+            for j in range(cols):
+                cell = cells[i * cols + j]
+                if cell == "0":
+                    row.append({'orb_count': 0, 'color': ' '})
+                else:
+                    row.append({'orb_count': int(cell[:-1]), 'color': cell[-1]})
+            board_data.append(row)
+        return board_data, over
+
+    def new_game(self, rows, cols):
+        return self.parse_board(self.send(f"new {rows} {cols}"))
+
+    def set_position(self, board_data):
+        """Load a whole board in one call"""
+        cells = []
+        for row in board_data:
+            for cell in row:
+                cells.append("0" if cell['color'] == ' ' else f"{cell['orb_count']}{cell['color']}")
+        rows, cols = len(board_data), len(board_data[0])
+        return self.parse_board(self.send(f"position {rows} {cols} " + " ".join(cells)))
+
+    def play(self, row, col, color):
+        """Apply a move, explosions included, and return the new board"""
+        return self.parse_board(self.send(f"play {row} {col} {color}"))
+
+    def parse_move(self, reply):
+        parts = reply.split()
+        return int(parts[1]), int(parts[2])
+
+    def start_search(self, color, depth=3, time_ms=0):
+        """Start a search for `color` in the background and return at once"""
+        self.send(f"go {color} {depth} {time_ms}")
+
+    def poll(self):
+        """(done, depth, (row, col)) for the running search. Once done, the
+        move has been played and depth is None"""
+        reply = self.send("poll")
+        if reply.startswith("bestmove"):
+            return True, None, self.parse_move(reply)
+        parts = reply.split()
+        return False, int(parts[1]), (int(parts[2]), int(parts[3]))
+
+    def stop(self):
+        """Cut the running search short; its best move so far is played"""
+        return self.parse_move(self.send("stop"))
+
+    def best_move(self, color, depth=3, time_ms=0):
+        """Let the engine search and play for `color`; returns (row, col)"""
+        self.start_search(color, depth, time_ms)
+        return self.parse_move(self.send("wait"))
+
+    def board(self):
+        return self.parse_board(self.send("board"))
+
+    def close(self):
+        if self.process.poll() is None:
+            self.process.stdin.write("quit\n")
+            self.process.stdin.flush()
+            self.process.wait()
@@ -78,12 +78,7 @@ while running:
                         "player2": result["player2"]
                     }
                     # Set up game screen with selected players
-                    if game_state.settings["ai_difficulty"] == "Normal":
-                        ai_difficulty = 2
-                    elif game_state.settings["ai_difficulty"] == "Medium":
-                        ai_difficulty = 3
-                    elif game_state.settings["ai_difficulty"] == "Hard":
-                        ai_difficulty = 4
+                    ai_difficulty = AI_DEPTHS[game_state.settings["ai_difficulty"]]
                     game_screen.set_players(result["player1"], result["player2"], ai_difficulty)
                     game_screen.reset_game()
                     # Switch to game screen
@@ -104,7 +99,7 @@ while running:
                 # Set up game screen with selected players
                 rows = int(game_state.settings["grid_size"].split('x')[0])
                 cols = int(game_state.settings["grid_size"].split('x')[1])
-                game_screen.set_players(result["player1"], result["player2"],)
+                game_screen.set_players(result["player1"], result["player2"], AI_DEPTHS[game_state.settings["ai_difficulty"]])
                 game_screen.reset_grid(rows,cols)
                 game_screen.reset_game()
                 # Switch to game screen
@@ -144,6 +139,7 @@ while running:
     if game_state.current_screen == "main_menu":
         menu_screen.draw()
     elif game_state.current_screen == "game":
+        game_screen.update()
         game_screen.draw()
     elif game_state.current_screen == "settings":
         settings_screen.draw()
@@ -152,5 +148,6 @@ while running:
     clock.tick(FPS)
 
 print("Game loop ended")
+game_screen.engine.close()
 pygame.quit()
 sys.exit()
\ No newline at end of file
@@ -1,11 +1,11 @@
 import pygame
 import sys
 import math
-import time
 from config import *
 from components import Button, Dropdown
+from engine import EngineClient, EngineError
 
-# GameScreen class that uses file communication
+# GameScreen class that plays through the C++ engine process
 class GameScreen:
     def __init__(self, screen, rows=5, cols=6):
         self.screen = screen
@@ -23,6 +23,12 @@ class GameScreen:
         self.turn = 0
         self.game_over = False
         self.winner = None
+        self.players = {'R': "Human", 'B': "AI"}
+        self.ai_depth = 2
+        self.ai_thinking = False
+        self.ai_progress = None  # (depth, (row, col)) of the running search
+        self.engine = EngineClient()
+        self.engine.new_game(rows, cols)
         
         # Initialize fonts
         self.font = pygame.font.Font(None, NORMAL_FONT_SIZE)
@@ -45,97 +51,22 @@ class GameScreen:
         self.grid_y = (HEIGHT - self.grid_height) // 2
         self.game_over = False
         self.winner = None
+        self.cancel_ai_turn()
+        self.engine.new_game(rows, cols)
         print(f"Board reset to {rows}x{cols}")
+
+    def set_players(self, player1, player2, ai_depth=2):
+        """Choose Human or AI for Red (player 1) and Blue (player 2)"""
+        self.players = {'R': player1, 'B': player2}
+        self.ai_depth = ai_depth
     
-    def read_gamestate_file(self):
-        """Read gamestate from file and update board_data"""
-        try:
-            with open("../gamestate.txt", 'r') as f:
-                lines = f.readlines()
-            
-            if not lines:
-                return None
-                
-            header = lines[0].strip()
-            
-            # Parse board lines
-            for i in range(1, min(len(lines), self.rows + 1)):
-                row_data = lines[i].strip().split()
-                for j in range(min(len(row_data), self.cols)):
-                    cell = row_data[j]
-                    if cell == "0":
-                        self.board_data[i-1][j] = {'orb_count': 0, 'color': ' '}
-                    else:
-                        # Format: "nC" where n=orb count, C=color
-                        orb_count = int(cell[:-1])
-                        color = cell[-1]
-                        self.board_data[i-1][j] = {'orb_count': orb_count, 'color': color}
-            
-            return header
-            
-        except FileNotFoundError:
-            return None
-        except Exception as e:
-            print(f"Error reading gamestate: {e}")
-            return None
-    
-    def write_gamestate_file(self):
-        """Write current board state to file"""
-        try:
-            with open("../gamestate.txt", 'w') as f:
-                f.write("HUMAN MOVE:\n")
-                
-                for i in range(self.rows):
-                    row = []
-                    for j in range(self.cols):
-                        cell = self.board_data[i][j]
-                        if cell['color'] == ' ':
-                            row.append("0")
-                        else:
-                            row.append(f"{cell['orb_count']}{cell['color']}")
-                    f.write(" ".join(row) + "\n")
-            
-            print("Human move written to gamestate file")
-            
-        except Exception as e:
-            print(f"Error writing gamestate: {e}")
-    
-    def wait_for_ai_move(self):
-        """Wait for AI to make move and update board"""
-        print("Waiting for AI move...")
-        start_time = time.time()
-        
-        while time.time() - start_time < 10:  # 10 second timeout
-            header = self.read_gamestate_file()
-            if header == "AI MOVE:":
-                print("AI move received!")
-                self.check_game_over()
-                return True
-            time.sleep(0.1)
-        
-        print("Timeout waiting for AI move")
-        return False
-    
-    def check_game_over(self):
-        """Check if game is over"""
-        red_count = 0
-        blue_count = 0
-        
-        for i in range(self.rows):
-            for j in range(self.cols):
-                if self.board_data[i][j]['color'] == 'R':
-                    red_count += self.board_data[i][j]['orb_count']
-                elif self.board_data[i][j]['color'] == 'B':
-                    blue_count += self.board_data[i][j]['orb_count']
-        
-        # Game over if one player has no orbs (and it's not the first few turns)
-        if self.turn > 4:
-            if red_count == 0:
-                self.game_over = True
-                self.winner = 'B'
-            elif blue_count == 0:
-                self.game_over = True
-                self.winner = 'R'
+    def apply_engine_board(self, result):
+        """Take the board the engine sent back after the current player's move"""
+        self.board_data, over = result
+        if over:
+            # a move can only end the game by wiping out the other player
+            self.game_over = True
+            self.winner = self.current_color
     
     def get_cell_at_pos(self, pos):
         """Get the grid cell at the given screen position"""
@@ -266,6 +197,16 @@ class GameScreen:
         turn_rect = turn_surf.get_rect(center=(WIDTH // 2, 70))
         self.screen.blit(turn_surf, turn_rect)
         
+        # Engine progress while the AI thinks
+        if self.ai_thinking:
+            think_text = "AI thinking..."
+            if self.ai_progress and self.ai_progress[0] > 0:
+                depth, (row, col) = self.ai_progress
+                think_text = f"AI thinking... depth {depth}, best ({row}, {col})"
+            think_surf = self.small_font.render(think_text, True, DARK_GRAY)
+            think_rect = think_surf.get_rect(center=(WIDTH // 2, self.grid_y + self.grid_height + 20))
+            self.screen.blit(think_surf, think_rect)
+        
         # Winner
         if self.game_over and self.winner:
             winner_color = RED if self.winner == 'R' else BLUE
@@ -287,51 +228,68 @@ class GameScreen:
         self.draw_player_info()
         self.draw_grid()
     
-    def make_human_move(self, row, col):
-        """Make human move and update file"""
-        if self.game_over:
+    def play_move(self, row, col):
+        """Play a move for the current player through the engine"""
+        try:
+            self.apply_engine_board(self.engine.play(row, col, self.current_color))
+        except EngineError as e:
+            print(f"Move rejected: {e}")
             return False
-        
-        cell = self.board_data[row][col]
-        if cell['color'] == ' ' or cell['color'] == self.current_color:
-            # Add orb to cell
-            cell['orb_count'] += 1
-            cell['color'] = self.current_color
-            
-            # Write to file
-            self.write_gamestate_file()
-            
-            # Switch turn and wait for AI
-            self.current_color = 'B' if self.current_color == 'R' else 'R'
-            self.turn += 1
-            
-            # Wait for AI response
-            if self.wait_for_ai_move():
-                # Switch back to human turn
-                self.current_color = 'B' if self.current_color == 'R' else 'R'
-                self.turn += 1
-            
-            return True
-        return False
+        self.current_color = 'B' if self.current_color == 'R' else 'R'
+        self.turn += 1
+        return True
+    
+    def play_ai_turns(self):
+        """Start the engine thinking if it is an AI's turn; update() picks up the move"""
+        if self.game_over or self.ai_thinking or self.players[self.current_color] != "AI":
+            return
+        self.engine.start_search(self.current_color, self.ai_depth)
+        self.ai_thinking = True
+        self.ai_progress = None
+
+    def cancel_ai_turn(self):
+        """Drop a running search, e.g. before the board is reset"""
+        if self.ai_thinking:
+            self.engine.stop()
+            self.ai_thinking = False
+            self.ai_progress = None
+
+    def update(self):
+        """Called once per frame: check on the engine without blocking"""
+        if not self.ai_thinking:
+            return
+        done, depth, (row, col) = self.engine.poll()
+        if not done:
+            self.ai_progress = (depth, (row, col))
+            return
+        print(f"AI played ({row}, {col})")
+        self.ai_thinking = False
+        self.ai_progress = None
+        self.apply_engine_board(self.engine.board())
+        self.current_color = 'B' if self.current_color == 'R' else 'R'
+        self.turn += 1
+        self.play_ai_turns()
     
     def handle_cell_click(self, row, col):
         """Handle a click on a cell"""
-        if self.game_over:
+        if self.game_over or self.players[self.current_color] != "Human":
             return False
-        
-        # Only allow human moves when it's human turn
-        if self.current_color == 'R':  # Assuming human is always Red
-            return self.make_human_move(row, col)
-        return False
+        if not self.play_move(row, col):
+            return False
+        self.play_ai_turns()
+        return True
     
     def reset_game(self):
         """Reset the game"""
-        self.board_data = [[{'orb_count': 0, 'color': ' '} for _ in range(self.cols)] for _ in range(self.rows)]
+        self.cancel_ai_turn()
+        self.board_data, _ = self.engine.new_game(self.rows, self.cols)
         self.current_color = 'R'
         self.turn = 0
         self.game_over = False
         self.winner = None
         print("Game reset successfully")
+        # an AI playing Red opens the game
+        self.play_ai_turns()
     
     def handle_events(self, event):
         """Handle game-specific events"""
@@ -0,0 +1,356 @@
+#ifndef BOOST_HPP
+#define BOOST_HPP
+
+#include "tree.hpp"
+using namespace std;
+
+// A node of a boosted tree. Leaves are numbered through `label`, which
+// indexes the tree's leaf values once it is flattened.
+struct BoostNode
+{
+    int feature_index;
+    float threshold;
+    int label;
+    BoostNode *left, *right;
+    CategorySet categories; // always empty: codes are split by threshold
+};
+
+// Sums over the rows of a node that fall in one bin.
+struct GradientBin
+{
+    double gradient;
+    double hessian;
+    int count;
+};
+
+// Gradient-boosted trees for two classes with logistic loss. Each round
+// fits a regression tree to the gradients of the current margins over the
+// binned training set, growing it leaf-wise: the leaf whose best split
+// gains the most is split next, up to MaxLeaves leaves. Trees are shrunk by
+// LearningRate, and training stops early once the validation loss has not
+// improved for EARLY_STOPPING rounds.
+class Booster
+{
+    int MaxRounds;
+    int MaxDepth;
+    int MaxLeaves;
+    double LearningRate;
+    int threads;
+    Tree encoder; // holds the categorical mappers for raw rows
+    vector<string> classes;
+    int features;
+    double base_margin;
+    vector<FlatTree> trees;
+    vector<vector<float>> leaf_values;
+    vector<double> validation_loss; // after each round
+
+    static constexpr double LAMBDA = 1.0;       // L2 penalty on leaf values
+    static constexpr double MIN_HESSIAN = 1e-3; // per child
+    static const int MIN_LEAF_ROWS = 20;
+    static const int EARLY_STOPPING = 20;
+    static const int PARALLEL_ROWS = 4096;
+    static const int BLOCK_ROWS = 256;
+
+    // A leaf of the tree being grown with its rows, their histogram and the
+    // best way to split it.
+    struct OpenLeaf
+    {
+        BoostNode *node;
+        int *begin, *end;
+        int depth;
+        vector<GradientBin> hist;
+        double gradient, hessian;
+        int feature, bin; // feature -1 when it cannot be split
+        double gain;
+    };
+
+    vector<int> bin_offsets;
+    vector<float> gradients, hessians;
+
+    static double log_loss(double margin, int label)
+    {
+        double z = label ? -margin : margin;
+        return z > 0 ? z + log1p(exp(-z)) : log1p(exp(z));
+    }
+
+    int helpers_for(int rows) const
+    {
+        return rows >= PARALLEL_ROWS ? threads - 1 : 0;
+    }
+
+    void gradient_histogram(const Dataset &data, OpenLeaf &leaf)
+    {
+        leaf.hist.assign(bin_offsets.back(), {0.0, 0.0, 0});
+        parallel_for(data.features(), helpers_for(leaf.end - leaf.begin), [&](int i)
+                     {
+            const uint8_t *bins = data.bins[i].data();
+            GradientBin *sums = leaf.hist.data() + bin_offsets[i];
+            for (const int *row = leaf.begin; row != leaf.end; row++)
+            {
+                GradientBin &sum = sums[bins[*row]];
+                sum.gradient += gradients[*row];
+                sum.hessian += hessians[*row];
+                sum.count++;
+            } });
+    }
+
+    // Totals from feature 0's bins, then the best bin to split after over
+    // all features, the first one winning ties.
+    void find_split(const Dataset &data, OpenLeaf &leaf)
+    {
+        leaf.gradient = leaf.hessian = 0.0;
+        for (int b = bin_offsets[0]; b < bin_offsets[1]; b++)
+        {
+            leaf.gradient += leaf.hist[b].gradient;
+            leaf.hessian += leaf.hist[b].hessian;
+        }
+        leaf.feature = -1;
+        leaf.gain = 0.0;
+        int rows = leaf.end - leaf.begin;
+        if (leaf.depth > MaxDepth || rows < 2 * MIN_LEAF_ROWS)
+            return;
+        double parent_score = leaf.gradient * leaf.gradient / (leaf.hessian + LAMBDA);
+        for (int i = 0; i < data.features(); i++)
+        {
+            double left_gradient = 0.0, left_hessian = 0.0;
+            int left_rows = 0;
+            for (int b = bin_offsets[i]; b < bin_offsets[i + 1]; b++)
+            {
+                const GradientBin &sum = leaf.hist[b];
+                if (sum.count == 0)
+                    continue;
+                left_gradient += sum.gradient;
+                left_hessian += sum.hessian;
+                left_rows += sum.count;
+                if (rows - left_rows < MIN_LEAF_ROWS)
+                    break;
+                double right_gradient = leaf.gradient - left_gradient, right_hessian = leaf.hessian - left_hessian;
+                if (left_rows < MIN_LEAF_ROWS || left_hessian < MIN_HESSIAN || right_hessian < MIN_HESSIAN)
+                    continue;
+                double gain = left_gradient * left_gradient / (left_hessian + LAMBDA) +
+                              right_gradient * right_gradient / (right_hessian + LAMBDA) - parent_score;
+                if (gain > leaf.gain)
+                {
+                    leaf.gain = gain;
+                    leaf.feature = i;
+                    leaf.bin = b - bin_offsets[i];
+                }
+            }
+        }
+    }
+
+    // Grows one tree over `rows`, flattens it and adds its leaf values to
+    // the margins of the rows in each leaf.
+    void grow_tree(const Dataset &data, vector<int> &rows, vector<double> &margins)
+    {
+        vector<BoostNode> nodes;
+        nodes.reserve(2 * MaxLeaves);
+        nodes.push_back({-1, 0.0f, -1, nullptr, nullptr, {}});
+        vector<OpenLeaf> leaves(1);
+        leaves[0].node = &nodes[0];
+        leaves[0].begin = rows.data();
+        leaves[0].end = rows.data() + rows.size();
+        leaves[0].depth = 0;
+        gradient_histogram(data, leaves[0]);
+        find_split(data, leaves[0]);
+
+        while ((int)leaves.size() < MaxLeaves)
+        {
+            int best = -1;
+            for (int k = 0; k < (int)leaves.size(); k++)
+                if (leaves[k].feature != -1 && (best == -1 || leaves[k].gain > leaves[best].gain))
+                    best = k;
+            if (best == -1)
+                break;
+            OpenLeaf parent = move(leaves[best]);
+            const uint8_t *bins = data.bins[parent.feature].data();
+            int *mid = partition(parent.begin, parent.end, [&](int row)
+                                 { return bins[row] <= parent.bin; });
+            parent.node->feature_index = parent.feature;
+            parent.node->threshold = data.edges[parent.feature][parent.bin];
+            nodes.push_back({-1, 0.0f, -1, nullptr, nullptr, {}});
+            parent.node->left = &nodes.back();
+            nodes.push_back({-1, 0.0f, -1, nullptr, nullptr, {}});
+            parent.node->right = &nodes.back();
+
+            OpenLeaf left = {parent.node->left, parent.begin, mid, parent.depth + 1, {}, 0.0, 0.0, -1, 0, 0.0};
+            OpenLeaf right = {parent.node->right, mid, parent.end, parent.depth + 1, {}, 0.0, 0.0, -1, 0, 0.0};
+            // count the smaller child, the other is the parent minus it
+            OpenLeaf &small = mid - parent.begin <= parent.end - mid ? left : right;
+            OpenLeaf &large = &small == &left ? right : left;
+            gradient_histogram(data, small);
+            large.hist = move(parent.hist);
+            for (size_t b = 0; b < large.hist.size(); b++)
+            {
+                large.hist[b].gradient -= small.hist[b].gradient;
+                large.hist[b].hessian -= small.hist[b].hessian;
+                large.hist[b].count -= small.hist[b].count;
+            }
+            find_split(data, left);
+            find_split(data, right);
+            leaves[best] = move(left);
+            leaves.push_back(move(right));
+        }
+
+        vector<float> values(leaves.size());
+        for (int k = 0; k < (int)leaves.size(); k++)
+        {
+            OpenLeaf &leaf = leaves[k];
+            leaf.node->label = k;
+            values[k] = -LearningRate * leaf.gradient / (leaf.hessian + LAMBDA);
+            for (const int *row = leaf.begin; row != leaf.end; row++)
+                margins[*row] += values[k];
+        }
+        trees.emplace_back(&nodes[0], data.features());
+        leaf_values.push_back(move(values));
+    }
+
+public:
+    Booster(int MaxRounds, int MaxDepth, double LearningRate = 0.1, int MaxLeaves = 31)
+        : MaxRounds(MaxRounds), MaxDepth(MaxDepth), MaxLeaves(MaxLeaves), LearningRate(LearningRate)
+    {
+        threads = max(1u, thread::hardware_concurrency());
+        features = 0;
+        base_margin = 0.0;
+    }
+
+    void set_threads(int count)
+    {
+        threads = max(1, count);
+    }
+
+    int get_rounds() const { return trees.size(); }
+    const vector<double> &get_validation_loss() const { return validation_loss; }
+
+    // Trains on some rows of a table and stops early on others, usually
+    // the two halves of a divide.
+    void fit(const Table &table, const vector<int> &rows, const vector<int> &validation_rows)
+    {
+        Dataset dataset = encoder.prepare(table, rows);
+        vector<float> validation((size_t)validation_rows.size() * table.features());
+        vector<int> validation_labels(validation_rows.size());
+        for (size_t r = 0; r < validation_rows.size(); r++)
+        {
+            table.encode(validation_rows[r], validation.data() + r * table.features());
+            validation_labels[r] = table.columns.back().codes[validation_rows[r]];
+        }
+        fit(dataset, validation, validation_labels);
+    }
+
+    // `validation` holds encoded rows one after another; it may be empty.
+    void fit(Dataset &dataset, const vector<float> &validation, const vector<int> &validation_labels)
+    {
+        trees.clear();
+        leaf_values.clear();
+        validation_loss.clear();
+        classes = dataset.classes;
+        features = dataset.features();
+        if (dataset.num_classes() != 2)
+        {
+            cerr << "Boosting needs exactly two classes, got " << dataset.num_classes() << endl;
+            return;
+        }
+        dataset.build_bins();
+        bin_offsets.assign(features + 1, 0);
+        for (int i = 0; i < features; i++)
+            bin_offsets[i + 1] = bin_offsets[i] + dataset.edges[i].size();
+
+        int size = dataset.size();
+        double positive = count(dataset.labels.begin(), dataset.labels.end(), 1);
+        double rate = min(max(positive / size, 1e-6), 1 - 1e-6);
+        base_margin = log(rate / (1 - rate));
+        vector<double> margins(size, base_margin);
+        gradients.resize(size);
+        hessians.resize(size);
+        vector<int> rows(size);
+        iota(rows.begin(), rows.end(), 0);
+
+        int validation_size = validation_labels.size();
+        vector<double> validation_margins(validation_size, base_margin);
+        vector<int> leaves(validation_size);
+        int best_round = 0;
+        double best_loss = numeric_limits<double>::max();
+        int blocks = (size + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        for (int round = 0; round < MaxRounds; round++)
+        {
+            parallel_for(blocks, helpers_for(size), [&](int b)
+                         {
+                for (int r = b * BLOCK_ROWS; r < min(size, (b + 1) * BLOCK_ROWS); r++)
+                {
+                    double p = 1.0 / (1.0 + exp(-margins[r]));
+                    gradients[r] = p - dataset.labels[r];
+                    hessians[r] = max(p * (1.0 - p), 1e-16);
+                } });
+            grow_tree(dataset, rows, margins);
+            if (validation_size == 0)
+                continue;
+
+            trees.back().predict(validation.data(), validation_size, leaves.data());
+            double loss = 0.0;
+            for (int r = 0; r < validation_size; r++)
+            {
+                validation_margins[r] += leaf_values.back()[leaves[r]];
+                loss += log_loss(validation_margins[r], validation_labels[r]);
+            }
+            validation_loss.push_back(loss / validation_size);
+            if (validation_loss.back() < best_loss)
+            {
+                best_loss = validation_loss.back();
+                best_round = round + 1;
+            }
+            else if (round + 1 - best_round >= EARLY_STOPPING)
+                break;
+        }
+        if (validation_size > 0)
+        {
+            trees.resize(best_round);
+            leaf_values.resize(best_round);
+        }
+        gradients = vector<float>();
+        hessians = vector<float>();
+    }
+
+    // Log-odds of the second class for `count` encoded rows stored one
+    // after another. Each block of rows goes through every tree in turn.
+    void predict_margins(const float *rows, int count, double *out)
+    {
+        int blocks = (count + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        parallel_for(blocks, helpers_for(count), [&](int b)
+                     {
+            int first = b * BLOCK_ROWS, n = min(count, first + BLOCK_ROWS) - first;
+            vector<int> leaves(n);
+            fill(out + first, out + first + n, base_margin);
+            for (size_t t = 0; t < trees.size(); t++)
+            {
+                trees[t].predict(rows + (size_t)first * features, n, leaves.data());
+                for (int r = 0; r < n; r++)
+                    out[first + r] += leaf_values[t][leaves[r]];
+            } });
+    }
+
+    // Class indices for `count` encoded rows stored one after another.
+    vector<int> predict_labels(const float *rows, int count)
+    {
+        vector<double> margins(count);
+        predict_margins(rows, count, margins.data());
+        vector<int> labels(count);
+        for (int r = 0; r < count; r++)
+            labels[r] = margins[r] > 0;
+        return labels;
+    }
+
+    double accuracy(const Table &table, const vector<int> &rows)
+    {
+        vector<float> encoded((size_t)rows.size() * features);
+        for (size_t r = 0; r < rows.size(); r++)
+            table.encode(rows[r], encoded.data() + r * features);
+        vector<int> labels = predict_labels(encoded.data(), rows.size());
+        int correct_predictions = 0;
+        for (size_t r = 0; r < rows.size(); r++)
+            if (labels[r] == table.columns.back().codes[rows[r]])
+                correct_predictions++;
+        return static_cast<double>(correct_predictions) / rows.size();
+    }
+};
+
+#endif
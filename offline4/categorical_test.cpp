@@ -0,0 +1,113 @@
+#include <iostream>
+#include <random>
+#include <cstdio>
+#include "tree.hpp"
+using namespace std;
+
+// Histogram splits on a categorical feature with more categories than
+// bins. A bin is one group of codes to every split, so all the codes in a
+// bin must reach the same leaf of the compiled tree. Batch prediction (the
+// AVX2 walk when built for it) and a saved and reloaded model must then
+// give every code, and codes outside the sets, the class of that leaf.
+//
+//   categorical_test
+
+const char *MODEL_PATH = "categorical_test.model";
+
+int main()
+{
+    int failures = 0, trees = 0;
+    for (int categories : {300, 1000, 5000})
+        for (unsigned seed = 1; seed <= 20; seed++)
+        {
+            mt19937 rng(seed);
+            Dataset dataset;
+            dataset.classes = {"0", "1"};
+            dataset.categorical = {1};
+            dataset.columns.assign(1, {});
+            vector<int> label_of(categories);
+            for (int code = 0; code < categories; code++)
+                label_of[code] = rng() % 2;
+            for (int code = 0; code < categories; code++)
+                for (int k = 0; k < 4; k++)
+                {
+                    dataset.columns[0].push_back(code);
+                    dataset.labels.push_back(k == 0 ? 1 - label_of[code] : label_of[code]);
+                }
+            dataset.build_bins();
+
+            Tree tree(2, "IG");
+            tree.set_histogram(true);
+            tree.fit_histogram(dataset, vector<int>(dataset.size(), 1));
+            FlatTreeView view = tree.flat.view();
+            if (!view.bitset)
+                continue;
+            trees++;
+
+            const vector<float> &edge = dataset.edges[0];
+            vector<int> leaf_of_bin(edge.size(), -1);
+            vector<float> rows;
+            vector<int> expected;
+            for (int code = 0; code < categories; code++)
+            {
+                int bin = lower_bound(edge.begin(), edge.end(), (float)code) - edge.begin();
+                int leaf = 0;
+                for (int level = 0; level < view.depth; level++)
+                    leaf = view.step<true>(leaf, code);
+                rows.push_back(code);
+                expected.push_back(view.label[leaf]);
+                if (leaf_of_bin[bin] == -1)
+                    leaf_of_bin[bin] = leaf;
+                else if (leaf_of_bin[bin] != leaf)
+                {
+                    failures++;
+                    cout << categories << " categories, seed " << seed << ": code " << code << " in bin " << bin
+                         << " reaches node " << leaf << ", the rest of its bin node " << leaf_of_bin[bin] << endl;
+                    break;
+                }
+            }
+            for (float outside : {-1.0f, (float)categories + 40, 1e9f})
+            {
+                int leaf = 0;
+                for (int level = 0; level < view.depth; level++)
+                    leaf = view.step<true>(leaf, outside);
+                rows.push_back(outside);
+                expected.push_back(view.label[leaf]);
+            }
+
+            vector<int> batch(rows.size());
+            view.predict(rows.data(), rows.size(), batch.data());
+            vector<map<string, int>> mappers(1);
+            for (int code = 0; code < categories; code++)
+                mappers[0]["c" + to_string(code)] = code;
+            Model model;
+            vector<int> loaded(rows.size(), -1);
+            if (!save_model(MODEL_PATH, {"x", "y"}, mappers, {true}, dataset.classes, {&tree.flat}) ||
+                !model.load(MODEL_PATH))
+            {
+                failures++;
+                cout << categories << " categories, seed " << seed << ": model did not save and load" << endl;
+            }
+            else
+            {
+                model.predict(rows.data(), rows.size(), loaded.data());
+                if (model.category(0, "c" + to_string(categories - 1)) != categories - 1)
+                {
+                    failures++;
+                    cout << categories << " categories, seed " << seed << ": model lost category codes" << endl;
+                }
+            }
+            for (int r = 0; r < (int)rows.size(); r++)
+                if (batch[r] != expected[r] || loaded[r] != expected[r])
+                {
+                    failures++;
+                    cout << categories << " categories, seed " << seed << ": value " << rows[r] << " is class "
+                         << expected[r] << " stepping, " << batch[r] << " in a batch, " << loaded[r]
+                         << " from the model" << endl;
+                    break;
+                }
+        }
+    remove(MODEL_PATH);
+    cout << trees << " trees checked, " << failures << " failures" << endl;
+    return failures == 0 && trees > 0 ? 0 : 1;
+}
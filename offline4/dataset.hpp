@@ -0,0 +1,74 @@
+#ifndef DATASET_HPP
+#define DATASET_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+using namespace std;
+
+// Upper bin edges for some values of a feature: one per distinct value if
+// there are at most max_bins of them, else cuts at quantiles. Sorts values.
+inline vector<float> bin_edges(vector<float> &values, int max_bins)
+{
+    sort(values.begin(), values.end());
+    vector<float> edge;
+    unique_copy(values.begin(), values.end(), back_inserter(edge));
+    if ((int)edge.size() > max_bins)
+    {
+        edge.clear();
+        for (int j = 1; j <= max_bins; j++)
+        {
+            float cut = values[(long long)j * values.size() / max_bins - 1];
+            if (edge.empty() || cut != edge.back())
+                edge.push_back(cut);
+        }
+    }
+    return edge;
+}
+
+// Training data stored by column: one contiguous array per feature and the
+// labels as indices into `classes`. Tree nodes refer to rows by index, so
+// nothing is copied while the tree is built.
+struct Dataset
+{
+    vector<vector<float>> columns;
+    vector<int> labels;
+    vector<string> classes; // sorted, so ties go to the smallest label
+    // per feature: 1 if its values are category codes, split by set
+    // membership rather than by threshold
+    vector<char> categorical;
+
+    // Histogram mode: every feature quantized to at most MAX_BINS codes.
+    // Bin b holds the values in (edges[b - 1], edges[b]], so splitting after
+    // bin b is the threshold edges[b].
+    static const int MAX_BINS = 256;
+    vector<vector<uint8_t>> bins;
+    vector<vector<float>> edges;
+
+    int size() const { return labels.size(); }
+    int features() const { return columns.size(); }
+    int num_classes() const { return classes.size(); }
+    bool is_categorical(int i) const { return i < (int)categorical.size() && categorical[i]; }
+
+    // A feature with at most max_bins distinct values gets one bin per value,
+    // which gives the same splits as the exact search. Others are cut at
+    // quantiles of the training values.
+    void build_bins(int max_bins = MAX_BINS)
+    {
+        bins.assign(features(), vector<uint8_t>(size()));
+        edges.assign(features(), vector<float>());
+        vector<float> values;
+        for (int i = 0; i < features(); i++)
+        {
+            values = columns[i];
+            edges[i] = bin_edges(values, max_bins);
+            const vector<float> &edge = edges[i];
+            for (int r = 0; r < size(); r++)
+                bins[i][r] = lower_bound(edge.begin(), edge.end(), columns[i][r]) - edge.begin();
+        }
+    }
+};
+
+#endif
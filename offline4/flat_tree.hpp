@@ -0,0 +1,270 @@
+#ifndef FLAT_TREE_HPP
+#define FLAT_TREE_HPP
+
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+using namespace std;
+
+// The category codes a categorical split sends left, one bit per code.
+typedef vector<uint64_t> CategorySet;
+
+inline bool in_category_set(const uint64_t *words, size_t count, float code)
+{
+    if (!(code >= 0.0f && code < 64.0f * count))
+        return false;
+    int c = code;
+    return words[c / 64] >> (c % 64) & 1;
+}
+
+inline void add_to_category_set(CategorySet &set, int code)
+{
+    if ((size_t)code / 64 >= set.size())
+        set.resize(code / 64 + 1, 0);
+    set[code / 64] |= 1ULL << (code % 64);
+}
+
+// A trained tree laid out breadth-first in flat arrays. Internal node i
+// sends a row to child[i] when row[feature[i]] <= threshold[i] and to
+// child[i] + 1 otherwise. A leaf points at itself with an infinite
+// threshold, so a row that reaches it stays there; every row can then take
+// exactly `depth` steps without checking for leaves.
+//
+// When some node is categorical, every node also has bitset[i], the start
+// of a set in category_bits: a word count n, n 32-bit words and a zero
+// word. A categorical node has an infinite threshold and sends right the
+// codes outside its set; the other nodes share the empty set at 0. Both
+// tests then run on every node without branching. bitset is null when no
+// node is categorical, which keeps the threshold-only loops.
+//
+// The view only points at the arrays, which a FlatTree owns or a mapped
+// model file holds.
+struct FlatTreeView
+{
+    const int *feature;
+    const float *threshold;
+    const int *child;
+    const int *label; // class index at leaves, -1 inside
+    const int *bitset;
+    const uint32_t *category_bits;
+    int depth;
+    int features;
+
+    // rows advanced together, level by level
+    static constexpr int BATCH_ROWS = 64;
+
+    template <bool SETS>
+    int step(int at, float x) const
+    {
+        int right = x > threshold[at];
+        if (SETS)
+        {
+            const uint32_t *set = category_bits + bitset[at];
+            uint32_t words = set[0];
+            bool inside = x >= 0.0f && x < 32.0f * words;
+            int code = inside ? (int)x : 32 * words; // outside lands on the zero word
+            right |= words != 0 && !(set[1 + code / 32] >> (code % 32) & 1);
+        }
+        return child[at] + right;
+    }
+
+    int classify(const float *row) const
+    {
+        int at = 0;
+        if (bitset)
+            for (int level = 0; level < depth; level++)
+                at = step<true>(at, row[feature[at]]);
+        else
+            for (int level = 0; level < depth; level++)
+                at = step<false>(at, row[feature[at]]);
+        return label[at];
+    }
+
+    // Class indices for `count` rows of `features` floats each, stored one
+    // after another.
+    void predict(const float *rows, int count, int *out) const
+    {
+        if (bitset)
+            walk<true>(rows, count, out);
+        else
+            walk<false>(rows, count, out);
+    }
+
+    template <bool SETS>
+    void walk(const float *rows, int count, int *out) const
+    {
+        int r = 0;
+#ifdef __AVX2__
+        // eight rows per register and GROUPS registers in flight, so the
+        // gathers of one group hide the latency of the others
+        const int GROUPS = 4;
+        const __m256i lane = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(features));
+        const __m256i stride = _mm256_set1_epi32(8 * features);
+        const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1), low_bits = _mm256_set1_epi32(31);
+        const int *bits = (const int *)category_bits;
+        for (; r + 8 * GROUPS <= count; r += 8 * GROUPS)
+        {
+            const float *block = rows + (size_t)r * features;
+            __m256i at[GROUPS], base[GROUPS];
+            for (int g = 0; g < GROUPS; g++)
+            {
+                at[g] = zero;
+                base[g] = g ? _mm256_add_epi32(base[g - 1], stride) : lane;
+            }
+            for (int level = 0; level < depth; level++)
+                for (int g = 0; g < GROUPS; g++)
+                {
+                    __m256i f = _mm256_i32gather_epi32(feature, at[g], 4);
+                    __m256 t = _mm256_i32gather_ps(threshold, at[g], 4);
+                    __m256i c = _mm256_i32gather_epi32(child, at[g], 4);
+                    __m256 x = _mm256_i32gather_ps(block, _mm256_add_epi32(base[g], f), 4);
+                    __m256i right = _mm256_castps_si256(_mm256_cmp_ps(x, t, _CMP_GT_OQ)); // -1 where taken
+                    if (SETS)
+                    {
+                        __m256i set = _mm256_i32gather_epi32(bitset, at[g], 4);
+                        __m256i words = _mm256_i32gather_epi32(bits, set, 4);
+                        __m256i limit = _mm256_slli_epi32(words, 5);
+                        __m256 inside = _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GE_OQ),
+                                                      _mm256_cmp_ps(x, _mm256_cvtepi32_ps(limit), _CMP_LT_OQ));
+                        __m256i code = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(limit),
+                                                                             _mm256_castsi256_ps(_mm256_cvttps_epi32(x)), inside));
+                        __m256i word = _mm256_i32gather_epi32(bits, _mm256_add_epi32(_mm256_add_epi32(set, one), _mm256_srli_epi32(code, 5)), 4);
+                        __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_and_si256(code, low_bits)), one);
+                        __m256i outside = _mm256_andnot_si256(_mm256_cmpeq_epi32(words, zero), _mm256_cmpeq_epi32(bit, zero));
+                        right = _mm256_or_si256(right, outside);
+                    }
+                    at[g] = _mm256_sub_epi32(c, right);
+                }
+            alignas(32) int index[8 * GROUPS];
+            for (int g = 0; g < GROUPS; g++)
+                _mm256_store_si256((__m256i *)index + g, at[g]);
+            for (int k = 0; k < 8 * GROUPS; k++)
+                out[r + k] = label[index[k]];
+        }
+#endif
+        int at[BATCH_ROWS];
+        for (; r < count; r += BATCH_ROWS)
+        {
+            int n = min(BATCH_ROWS, count - r);
+            const float *block = rows + (size_t)r * features;
+            fill(at, at + n, 0);
+            for (int level = 0; level < depth; level++)
+                for (int k = 0; k < n; k++)
+                    at[k] = step<SETS>(at[k], block[k * features + feature[at[k]]]);
+            for (int k = 0; k < n; k++)
+                out[r + k] = label[at[k]];
+        }
+    }
+};
+
+class FlatTree
+{
+    vector<int> feature;
+    vector<float> threshold;
+    vector<int> child;
+    vector<int> label;
+    vector<int> bitset; // empty when no node is categorical
+    vector<uint32_t> category_bits;
+    int depth;
+    int features;
+
+public:
+    FlatTree() : depth(0), features(0) {}
+
+    // Node is any type with feature_index, threshold, categories, label,
+    // left and right; feature_index -1 marks a leaf and non-empty
+    // categories a categorical split.
+    template <typename Node>
+    FlatTree(const Node *root, int features) : depth(0), features(features)
+    {
+        if (!root)
+            return;
+        queue<pair<const Node *, int>> pending; // node and its depth
+        pending.push({root, 0});
+        vector<const Node *> order;
+        while (!pending.empty())
+        {
+            auto [current, level] = pending.front();
+            pending.pop();
+            order.push_back(current);
+            depth = max(depth, level);
+            if (current->feature_index != -1)
+            {
+                pending.push({current->left, level + 1});
+                pending.push({current->right, level + 1});
+            }
+        }
+        int count = order.size();
+        feature.resize(count);
+        threshold.resize(count);
+        child.resize(count);
+        label.resize(count);
+        for (const Node *current : order)
+            if (!current->categories.empty())
+            {
+                bitset.assign(count, 0);
+                category_bits = {0, 0}; // the empty set
+                break;
+            }
+        int next = 1;
+        for (int i = 0; i < count; i++)
+        {
+            const Node *current = order[i];
+            if (current->feature_index == -1)
+            {
+                feature[i] = 0;
+                threshold[i] = INFINITY;
+                child[i] = i;
+                label[i] = current->label;
+            }
+            else
+            {
+                feature[i] = current->feature_index;
+                threshold[i] = current->threshold;
+                child[i] = next;
+                label[i] = -1;
+                next += 2;
+                if (!current->categories.empty())
+                {
+                    threshold[i] = INFINITY;
+                    bitset[i] = category_bits.size();
+                    category_bits.push_back(2 * current->categories.size());
+                    for (uint64_t word : current->categories)
+                    {
+                        category_bits.push_back(word);
+                        category_bits.push_back(word >> 32);
+                    }
+                    category_bits.push_back(0);
+                }
+            }
+        }
+    }
+
+    bool empty() const { return feature.empty(); }
+    int size() const { return feature.size(); }
+    int get_depth() const { return depth; }
+    int category_words() const { return category_bits.size(); }
+
+    FlatTreeView view() const
+    {
+        return {feature.data(), threshold.data(), child.data(), label.data(),
+                bitset.empty() ? nullptr : bitset.data(), category_bits.data(), depth, features};
+    }
+
+    int classify(const float *row) const
+    {
+        return view().classify(row);
+    }
+
+    void predict(const float *rows, int count, int *out) const
+    {
+        view().predict(rows, count, out);
+    }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef FOREST_HPP
+#define FOREST_HPP
+
+#include <memory>
+#include "tree.hpp"
+using namespace std;
+
+// Bagged histogram trees. Each tree trains on a bootstrap sample kept as
+// per-row draw counts over one shared binned dataset, and tries a random
+// subset of the features at every split. Rows a tree never drew give the
+// out-of-bag accuracy estimate.
+class Forest
+{
+    int NumTrees;
+    int MaxDepth;
+    int MaxFeatures; // 0 for the square root of the feature count
+    string criterion;
+    int threads;
+    Tree encoder; // holds the categorical mappers for raw rows
+    vector<unique_ptr<Tree>> trees;
+    vector<string> classes;
+    int features;
+    double oob_accuracy;
+
+    // rows per prediction block: every tree is walked over a block before
+    // the next tree, so a tree stays in cache while its votes are cast
+    static const int BLOCK_ROWS = 256;
+
+public:
+    Forest(int NumTrees, int MaxDepth, string criterion = "IG", int MaxFeatures = 0)
+        : NumTrees(NumTrees), MaxDepth(MaxDepth), MaxFeatures(MaxFeatures), criterion(criterion)
+    {
+        threads = max(1u, thread::hardware_concurrency());
+        features = 0;
+        oob_accuracy = 0.0;
+    }
+
+    void set_threads(int count)
+    {
+        threads = max(1, count);
+    }
+
+    double get_oob_accuracy() const { return oob_accuracy; }
+
+    // All trees in one model file; Model::predict takes their vote.
+    bool save(const string &path, const vector<string> &headers) const
+    {
+        vector<const FlatTree *> flats;
+        for (const auto &tree : trees)
+            flats.push_back(&tree->flat);
+        return save_model(path, headers, encoder.get_mappers(), encoder.get_categorical(), classes, flats);
+    }
+
+    void fit(vector<vector<string>> &data, vector<string> &headers, unsigned seed = 1)
+    {
+        Dataset dataset = encoder.prepare(data, headers);
+        fit(dataset, seed);
+    }
+
+    void fit(const Table &table, const vector<int> &rows, unsigned seed = 1)
+    {
+        Dataset dataset = encoder.prepare(table, rows);
+        fit(dataset, seed);
+    }
+
+    void fit(Dataset &dataset, unsigned seed)
+    {
+        dataset.build_bins();
+        classes = dataset.classes;
+        features = dataset.features();
+        int rows = dataset.size();
+        int per_split = MaxFeatures > 0 ? MaxFeatures : max(1, (int)sqrt((double)features));
+
+        vector<vector<int>> drawn(NumTrees);
+        trees.clear();
+        for (int t = 0; t < NumTrees; t++)
+        {
+            trees.emplace_back(new Tree(MaxDepth, criterion));
+            trees.back()->set_threads(1);
+        }
+        parallel_for(NumTrees, threads - 1, [&](int t)
+                     {
+            mt19937 rng(seed + t);
+            uniform_int_distribution<int> pick(0, rows - 1);
+            drawn[t].assign(rows, 0);
+            for (int k = 0; k < rows; k++)
+                drawn[t][pick(rng)]++;
+            trees[t]->fit_histogram(dataset, drawn[t], per_split, mix_seed(seed + t)); });
+
+        // each row is voted on by the trees that did not draw it
+        int correct = 0, voted = 0;
+        vector<float> row(features);
+        vector<int> votes(classes.size());
+        for (int r = 0; r < rows; r++)
+        {
+            for (int i = 0; i < features; i++)
+                row[i] = dataset.columns[i][r];
+            fill(votes.begin(), votes.end(), 0);
+            bool any = false;
+            for (int t = 0; t < NumTrees; t++)
+                if (drawn[t][r] == 0)
+                {
+                    votes[trees[t]->classify(row.data())]++;
+                    any = true;
+                }
+            if (!any)
+                continue;
+            voted++;
+            correct += max_element(votes.begin(), votes.end()) - votes.begin() == dataset.labels[r];
+        }
+        oob_accuracy = voted ? (double)correct / voted : 0.0;
+    }
+
+    // Class indices for `count` encoded rows stored one after another.
+    vector<int> predict_labels(const float *rows, int count)
+    {
+        int num_classes = classes.size();
+        vector<int> labels(count);
+        int blocks = (count + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        parallel_for(blocks, threads - 1, [&](int b)
+                     {
+            int first = b * BLOCK_ROWS, last = min(count, first + BLOCK_ROWS);
+            vector<int> votes((last - first) * num_classes, 0), tree_labels(last - first);
+            for (const auto &tree : trees)
+            {
+                tree->flat.predict(rows + (size_t)first * features, last - first, tree_labels.data());
+                for (int r = first; r < last; r++)
+                    votes[(r - first) * num_classes + tree_labels[r - first]]++;
+            }
+            for (int r = first; r < last; r++)
+            {
+                const int *counts = votes.data() + (r - first) * num_classes;
+                labels[r] = max_element(counts, counts + num_classes) - counts;
+            } });
+        return labels;
+    }
+
+    vector<string> predict(const vector<vector<string>> &data)
+    {
+        vector<float> encoded((size_t)data.size() * features);
+        for (size_t r = 0; r < data.size(); r++)
+            encoder.encode(data[r], encoded.data() + r * features);
+        vector<int> labels = predict_labels(encoded.data(), data.size());
+        vector<string> predictions(data.size());
+        for (size_t r = 0; r < data.size(); r++)
+            predictions[r] = classes[labels[r]];
+        return predictions;
+    }
+
+    double accuracy(const Table &table, const vector<int> &rows)
+    {
+        vector<float> encoded((size_t)rows.size() * features);
+        for (size_t r = 0; r < rows.size(); r++)
+            table.encode(rows[r], encoded.data() + r * features);
+        vector<int> labels = predict_labels(encoded.data(), rows.size());
+        int correct_predictions = 0;
+        for (size_t r = 0; r < rows.size(); r++)
+            if (labels[r] == table.columns.back().codes[rows[r]])
+                correct_predictions++;
+        return static_cast<double>(correct_predictions) / rows.size();
+    }
+
+    double accuracy(vector<vector<string>> &data)
+    {
+        vector<string> predictions = predict(data);
+        int correct_predictions = 0;
+        for (size_t r = 0; r < data.size(); r++)
+            if (predictions[r] == data[r].back())
+                correct_predictions++;
+        return static_cast<double>(correct_predictions) / data.size();
+    }
+};
+
+#endif
@@ -0,0 +1,461 @@
+#ifndef MODEL_HPP
+#define MODEL_HPP
+
+#include <vector>
+#include <map>
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "parser.hpp"
+#include "flat_tree.hpp"
+using namespace std;
+
+// A model file is a header followed by arrays, each starting at an 8-byte
+// aligned offset recorded in the header, so loading is mapping the file and
+// pointing into it. One file holds one or more trees over the same
+// features; with several, the prediction is their majority vote.
+enum ModelSection
+{
+    TREE_BEGIN,     // int[trees + 1]: first node of each tree
+    TREE_DEPTH,     // int[trees]
+    NODE_FEATURE,   // int[nodes], then the other node arrays of FlatTree
+    NODE_THRESHOLD, // float[nodes]
+    NODE_CHILD,     // int[nodes], relative to the tree's first node
+    NODE_LABEL,     // int[nodes]
+    NODE_BITSET,    // int[nodes]: where the node's category set starts
+    CATEGORY_BITS,  // uint32_t[category_words]: sets laid out as in FlatTree
+    CATEGORICAL,    // int[features]: 1 for a categorical feature
+    CATEGORY_BEGIN, // int[features + 1]: first category of each feature
+    CATEGORY_CODE,  // int[categories]: code the tree compares
+    STRING_BEGIN,   // int[strings + 1]: offsets into STRING_BYTES
+    STRING_BYTES,   // feature names and label name, classes, categories
+    MODEL_SECTIONS
+};
+
+struct ModelHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t trees;
+    uint32_t features;
+    uint32_t classes;
+    uint32_t nodes;
+    uint32_t categories;
+    uint32_t strings;
+    uint32_t category_words;
+    uint64_t size;
+    uint64_t offset[MODEL_SECTIONS];
+};
+
+const char MODEL_MAGIC[8] = {'D', 'T', 'M', 'O', 'D', 'E', 'L', 0};
+const uint32_t MODEL_VERSION = 2; // 2 added categorical splits
+
+// Writes trees sharing one encoding: the mappers and categorical flags of
+// the tree that prepared the data, `headers` with the label name last.
+// Categories are stored in string order so a lookup is a binary search.
+inline bool save_model(const string &path, const vector<string> &headers, const vector<map<string, int>> &mappers,
+                       const vector<bool> &isCategorical, const vector<string> &classes, const vector<const FlatTree *> &trees)
+{
+    int features = mappers.size();
+    ModelHeader header = {};
+    memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    header.version = MODEL_VERSION;
+    header.trees = trees.size();
+    header.features = features;
+    header.classes = classes.size();
+
+    vector<int> tree_begin = {0}, tree_depth, feature, child, label, bitset;
+    vector<float> threshold;
+    vector<uint32_t> category_bits = {0, 0}; // the empty set
+    for (const FlatTree *tree : trees)
+    {
+        FlatTreeView view = tree->view();
+        feature.insert(feature.end(), view.feature, view.feature + tree->size());
+        threshold.insert(threshold.end(), view.threshold, view.threshold + tree->size());
+        child.insert(child.end(), view.child, view.child + tree->size());
+        label.insert(label.end(), view.label, view.label + tree->size());
+        int base = category_bits.size();
+        for (int i = 0; i < tree->size(); i++)
+            bitset.push_back(view.bitset ? base + view.bitset[i] : 0);
+        if (view.bitset)
+            category_bits.insert(category_bits.end(), view.category_bits, view.category_bits + tree->category_words());
+        tree_begin.push_back(feature.size());
+        tree_depth.push_back(tree->get_depth());
+    }
+    header.nodes = feature.size();
+    header.category_words = category_bits.size();
+
+    vector<string> strings;
+    for (int i = 0; i <= features; i++)
+        strings.push_back(i < (int)headers.size() ? headers[i] : "");
+    strings.insert(strings.end(), classes.begin(), classes.end());
+    vector<int> categorical(features), category_begin = {0}, category_code;
+    for (int i = 0; i < features; i++)
+    {
+        categorical[i] = i < (int)isCategorical.size() && isCategorical[i];
+        for (const auto &entry : mappers[i])
+        {
+            strings.push_back(entry.first);
+            category_code.push_back(entry.second);
+        }
+        category_begin.push_back(category_code.size());
+    }
+    header.categories = category_code.size();
+    header.strings = strings.size();
+    vector<int> string_begin = {0};
+    string bytes;
+    for (const string &text : strings)
+    {
+        bytes += text;
+        string_begin.push_back(bytes.size());
+    }
+
+    vector<pair<const void *, size_t>> sections = {
+        {tree_begin.data(), tree_begin.size() * sizeof(int)},
+        {tree_depth.data(), tree_depth.size() * sizeof(int)},
+        {feature.data(), feature.size() * sizeof(int)},
+        {threshold.data(), threshold.size() * sizeof(float)},
+        {child.data(), child.size() * sizeof(int)},
+        {label.data(), label.size() * sizeof(int)},
+        {bitset.data(), bitset.size() * sizeof(int)},
+        {category_bits.data(), category_bits.size() * sizeof(uint32_t)},
+        {categorical.data(), categorical.size() * sizeof(int)},
+        {category_begin.data(), category_begin.size() * sizeof(int)},
+        {category_code.data(), category_code.size() * sizeof(int)},
+        {string_begin.data(), string_begin.size() * sizeof(int)},
+        {bytes.data(), bytes.size()}};
+    uint64_t at = sizeof(ModelHeader);
+    for (int s = 0; s < MODEL_SECTIONS; s++)
+    {
+        at = (at + 7) & ~7ULL;
+        header.offset[s] = at;
+        at += sections[s].second;
+    }
+    header.size = at;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        cerr << "Error opening file: " << path << endl;
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    const char padding[8] = {};
+    at = sizeof(ModelHeader);
+    for (int s = 0; s < MODEL_SECTIONS; s++)
+    {
+        fwrite(padding, 1, header.offset[s] - at, file);
+        fwrite(sections[s].first, 1, sections[s].second, file);
+        at = header.offset[s] + sections[s].second;
+    }
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+        cerr << "Error writing file: " << path << endl;
+    return ok;
+}
+
+// A model file mapped read-only. The node arrays are used in place, so
+// processes scoring with the same model share its pages.
+class Model
+{
+    void *mapping;
+    size_t size;
+    const ModelHeader *header;
+    vector<FlatTreeView> trees;
+    vector<bool> has_sets; // per tree: some node is categorical
+    const int *categorical;
+    const int *category_begin;
+    const int *category_code;
+    const int *string_begin;
+    const char *string_bytes;
+
+    // rows per block when several trees vote
+    static constexpr int BLOCK_ROWS = 256;
+
+    template <typename T>
+    const T *section(int s) const
+    {
+        return (const T *)((const char *)mapping + header->offset[s]);
+    }
+
+    string_view text(int s) const
+    {
+        return string_view(string_bytes + string_begin[s], string_begin[s + 1] - string_begin[s]);
+    }
+
+    bool fits(int s, uint64_t count, size_t item) const
+    {
+        return header->offset[s] % 8 == 0 && header->offset[s] <= size && count * item <= size - header->offset[s];
+    }
+
+    bool check()
+    {
+        if (size < sizeof(ModelHeader))
+            return false;
+        header = (const ModelHeader *)mapping;
+        if (memcmp(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0 || header->version != MODEL_VERSION || header->size != size)
+        {
+            if (memcmp(header->magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) == 0 && header->version != MODEL_VERSION)
+                cerr << "Model version " << header->version << ", expected " << MODEL_VERSION << endl;
+            return false;
+        }
+        uint64_t trees = header->trees, nodes = header->nodes, features = header->features;
+        uint64_t strings = header->strings;
+        if (trees == 0 || features == 0 || header->classes == 0 || strings != features + 1 + header->classes + header->categories)
+            return false;
+        if (!fits(TREE_BEGIN, trees + 1, 4) || !fits(TREE_DEPTH, trees, 4) || !fits(NODE_FEATURE, nodes, 4) ||
+            !fits(NODE_THRESHOLD, nodes, 4) || !fits(NODE_CHILD, nodes, 4) || !fits(NODE_LABEL, nodes, 4) ||
+            !fits(NODE_BITSET, nodes, 4) || !fits(CATEGORY_BITS, header->category_words, 4) ||
+            !fits(CATEGORICAL, features, 4) || !fits(CATEGORY_BEGIN, features + 1, 4) ||
+            !fits(CATEGORY_CODE, header->categories, 4) || !fits(STRING_BEGIN, strings + 1, 4))
+            return false;
+        string_begin = section<int>(STRING_BEGIN);
+        for (uint64_t s = 0; s < strings; s++)
+            if (string_begin[s] < 0 || string_begin[s] > string_begin[s + 1])
+                return false;
+        if (string_begin[0] != 0 || !fits(STRING_BYTES, string_begin[strings], 1))
+            return false;
+        category_begin = section<int>(CATEGORY_BEGIN);
+        for (uint64_t i = 0; i < features; i++)
+            if (category_begin[i] > category_begin[i + 1])
+                return false;
+        if (category_begin[0] != 0 || category_begin[features] != (int)header->categories)
+            return false;
+
+        // children come after their parent and leaves loop on themselves, so
+        // `depth` steps from the root end on a leaf of the same tree
+        const int *begin = section<int>(TREE_BEGIN), *depth = section<int>(TREE_DEPTH);
+        const int *feature = section<int>(NODE_FEATURE), *child = section<int>(NODE_CHILD), *label = section<int>(NODE_LABEL);
+        const int *bitset = section<int>(NODE_BITSET);
+        const uint32_t *bits = section<uint32_t>(CATEGORY_BITS);
+        int64_t words = header->category_words;
+        has_sets.assign(trees, false);
+        if (begin[0] != 0 || begin[trees] != (int)nodes)
+            return false;
+        vector<int> level;
+        for (uint64_t t = 0; t < trees; t++)
+        {
+            int first = begin[t], count = begin[t + 1] - first;
+            if (count <= 0 || depth[t] < 0 || depth[t] >= count)
+                return false;
+            level.assign(count, 0);
+            for (int i = 0; i < count; i++)
+            {
+                int f = feature[first + i], c = child[first + i], l = label[first + i], o = bitset[first + i];
+                if (f < 0 || f >= (int)features || l < -1 || l >= (int)header->classes)
+                    return false;
+                // a set is its word count, the words and a zero word
+                if (o < 0 || o + 2 > words || bits[o] > words - o - 2 || bits[o + 1 + bits[o]] != 0 || (bits[o] && l >= 0))
+                    return false;
+                has_sets[t] = has_sets[t] || bits[o];
+                if (l >= 0 && c != i)
+                    return false;
+                if (l < 0)
+                {
+                    if (c <= i || c + 1 >= count || level[i] >= depth[t])
+                        return false;
+                    level[c] = level[c + 1] = level[i] + 1;
+                }
+            }
+        }
+        return true;
+    }
+
+public:
+    Model() : mapping(nullptr), size(0), header(nullptr) {}
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    ~Model()
+    {
+        unload();
+    }
+
+    void unload()
+    {
+        if (mapping)
+            munmap(mapping, size);
+        mapping = nullptr;
+        header = nullptr;
+        trees.clear();
+    }
+
+    bool load(const string &path)
+    {
+        unload();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            cerr << "Error opening file: " << path << endl;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            close(fd);
+            cerr << "Not a model file: " << path << endl;
+            return false;
+        }
+        size = info.st_size;
+        mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            mapping = nullptr;
+            cerr << "Error opening file: " << path << endl;
+            return false;
+        }
+        if (!check())
+        {
+            unload();
+            cerr << "Not a model file: " << path << endl;
+            return false;
+        }
+        categorical = section<int>(CATEGORICAL);
+        category_code = section<int>(CATEGORY_CODE);
+        string_bytes = section<char>(STRING_BYTES);
+        const int *begin = section<int>(TREE_BEGIN), *depth = section<int>(TREE_DEPTH);
+        for (uint32_t t = 0; t < header->trees; t++)
+            trees.push_back({section<int>(NODE_FEATURE) + begin[t], section<float>(NODE_THRESHOLD) + begin[t],
+                             section<int>(NODE_CHILD) + begin[t], section<int>(NODE_LABEL) + begin[t],
+                             has_sets[t] ? section<int>(NODE_BITSET) + begin[t] : nullptr, section<uint32_t>(CATEGORY_BITS),
+                             depth[t], (int)header->features});
+        return true;
+    }
+
+    bool loaded() const { return header != nullptr; }
+    int features() const { return header->features; }
+    int num_classes() const { return header->classes; }
+    int num_trees() const { return header->trees; }
+
+    // i == features() is the label column
+    string_view feature_name(int i) const { return text(i); }
+    string_view class_name(int label) const { return text(features() + 1 + label); }
+
+    // The code a categorical feature's value is compared as, 0 if unseen.
+    int category(int i, string_view value) const
+    {
+        int base = features() + 1 + num_classes();
+        int low = category_begin[i], high = category_begin[i + 1];
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (text(base + mid) < value)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low < category_begin[i + 1] && text(base + low) == value ? category_code[low] : 0;
+    }
+
+    // Encodes the first features() fields of a row like Table::encode:
+    // categories as their codes, missing or malformed numbers as 0.
+    void encode(const vector<string_view> &fields, float *out) const
+    {
+        for (int i = 0; i < features(); i++)
+        {
+            if (categorical[i])
+                out[i] = category(i, fields[i]);
+            else if (is_missing(fields[i]) || !parse_float(fields[i], out[i]))
+                out[i] = 0;
+        }
+    }
+
+    // Class indices for `count` encoded rows stored one after another.
+    void predict(const float *rows, int count, int *out) const
+    {
+        if (trees.size() == 1)
+        {
+            trees[0].predict(rows, count, out);
+            return;
+        }
+        int classes = num_classes();
+        vector<int> votes, tree_labels(BLOCK_ROWS);
+        for (int first = 0; first < count; first += BLOCK_ROWS)
+        {
+            int n = min(BLOCK_ROWS, count - first);
+            votes.assign(n * classes, 0);
+            for (const FlatTreeView &tree : trees)
+            {
+                tree.predict(rows + (size_t)first * features(), n, tree_labels.data());
+                for (int r = 0; r < n; r++)
+                    votes[r * classes + tree_labels[r]]++;
+            }
+            for (int r = 0; r < n; r++)
+            {
+                const int *counts = votes.data() + r * classes;
+                out[first + r] = max_element(counts, counts + classes) - counts;
+            }
+        }
+    }
+};
+
+
+// Scores a CSV stream row by row, writing one class name per line. Rows
+// with one field more than the model has features carry a label: those are
+// counted in `labeled`, and the ones predicted right in `correct`. A first line holding the feature names is skipped,
+// as are lines with too few fields. Returns the number of rows scored.
+inline long long score_csv(const Model &model, FILE *in, FILE *out, long long &labeled, long long &correct)
+{
+    const int BATCH_ROWS = 4096;
+    int features = model.features();
+    vector<float> encoded((size_t)BATCH_ROWS * features);
+    vector<int> expected(BATCH_ROWS), labels(BATCH_ROWS);
+    vector<string_view> fields;
+    string written;
+    long long scored = 0;
+    labeled = correct = 0;
+    int batch = 0;
+    bool first_line = true;
+
+    auto flush = [&]()
+    {
+        model.predict(encoded.data(), batch, labels.data());
+        written.clear();
+        for (int r = 0; r < batch; r++)
+        {
+            written += model.class_name(labels[r]);
+            written += '\n';
+            labeled += expected[r] >= 0;
+            correct += labels[r] == expected[r];
+        }
+        fwrite(written.data(), 1, written.size(), out);
+        scored += batch;
+        batch = 0;
+    };
+
+    for_each_line(in, [&](string_view line)
+                  {
+        split_fields(line, false, fields);
+        if ((int)fields.size() < features)
+            return;
+        if (first_line)
+        {
+            first_line = false;
+            bool names = true;
+            for (int i = 0; i < features && names; i++)
+                names = fields[i] == model.feature_name(i);
+            if (names)
+                return;
+        }
+        model.encode(fields, encoded.data() + (size_t)batch * features);
+        expected[batch] = -1;
+        if ((int)fields.size() == features + 1)
+            for (int c = 0; c < model.num_classes(); c++)
+                if (fields[features] == model.class_name(c))
+                    expected[batch] = c;
+        if (++batch == BATCH_ROWS)
+            flush(); });
+    flush();
+    return scored;
+}
+
+#endif
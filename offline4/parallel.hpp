@@ -0,0 +1,61 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+using namespace std;
+
+// Threads a computation may still start on top of the ones already running.
+// Tasks take threads when there is work worth splitting and hand them back
+// when done, so nested parallel work never oversubscribes the machine.
+class ThreadBudget
+{
+    atomic<int> spare;
+
+public:
+    ThreadBudget(int threads = 1) : spare(threads - 1) {}
+
+    void reset(int threads)
+    {
+        spare = threads - 1;
+    }
+
+    // Takes up to `wanted` threads and returns how many it got.
+    int take(int wanted)
+    {
+        int available = spare.load();
+        while (available > 0)
+        {
+            int taken = min(available, wanted);
+            if (spare.compare_exchange_weak(available, available - taken))
+                return taken;
+        }
+        return 0;
+    }
+
+    void give_back(int threads)
+    {
+        spare += threads;
+    }
+};
+
+// Runs body(0) .. body(count - 1) on the calling thread and `helpers` more.
+inline void parallel_for(int count, int helpers, const function<void(int)> &body)
+{
+    atomic<int> next(0);
+    auto work = [&]()
+    {
+        for (int i = next++; i < count; i = next++)
+            body(i);
+    };
+    vector<thread> workers;
+    for (int t = 0; t < helpers; t++)
+        workers.emplace_back(work);
+    work();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
 #include <iostream>
 #include <vector>
 #include <map>
@@ -5,6 +8,16 @@
 #include <sstream>
 #include <string>
 #include <iomanip> 
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
 pair<vector<string>, vector<vector<string>>> parse(string csv,
@@ -129,4 +142,383 @@ void print_formatted_table(const vector<string>& headers, const vector<vector<st
         cout << endl;
     }
     print_line();
-}
\ No newline at end of file
+}
+
+// A column of a loaded CSV. Numeric columns keep floats; categorical ones
+// keep a code per row into `categories`, which is sorted.
+struct Column
+{
+    bool numeric;
+    vector<float> values;
+    vector<int> codes;
+    vector<string> categories;
+};
+
+// Typed columns of a whole CSV file; the last column is the label and is
+// always categorical.
+struct Table
+{
+    vector<string> headers;
+    vector<Column> columns;
+    int rows = 0;
+
+    int features() const { return (int)columns.size() - 1; }
+
+    // The features of one row as floats, categories as their codes.
+    void encode(int row, float *out) const
+    {
+        for (int i = 0; i < features(); i++)
+            out[i] = columns[i].numeric ? columns[i].values[row] : columns[i].codes[row];
+    }
+
+    const string &label(int row) const
+    {
+        return columns.back().categories[columns.back().codes[row]];
+    }
+};
+
+// Fields are separated by ',' and trimmed of spaces. "?" or an empty field
+// is missing: its own category in a categorical column, 0 in a numeric one.
+inline void split_fields(string_view line, bool skip_first_col, vector<string_view> &fields)
+{
+    fields.clear();
+    const char *at = line.data(), *end = at + line.size();
+    bool first = true;
+    while (true)
+    {
+        while (at < end && (*at == ' ' || *at == '\t'))
+            at++;
+        const char *stop = at < end ? (const char *)memchr(at, ',', end - at) : nullptr;
+        const char *field_end = stop ? stop : end;
+        const char *last = field_end;
+        while (last > at && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+            last--;
+        if (!(first && skip_first_col))
+            fields.emplace_back(at, last - at);
+        first = false;
+        if (!stop)
+            break;
+        at = stop + 1;
+    }
+}
+
+inline bool is_missing(string_view field)
+{
+    return field.empty() || field == "?";
+}
+
+inline bool parse_float(string_view field, float &value)
+{
+    const char *begin = field.data(), *end = field.data() + field.size();
+    if (begin != end && *begin == '+')
+        begin++;
+    // plain integers of up to 9 digits convert exactly, and are common
+    if (begin != end && end - begin <= 9)
+    {
+        int whole = 0;
+        const char *at = begin;
+        while (at != end && (unsigned)(*at - '0') < 10)
+            whole = whole * 10 + (*at++ - '0');
+        if (at == end)
+        {
+            value = whole;
+            return true;
+        }
+    }
+    auto result = from_chars(begin, end, value);
+    return result.ec == errc() && result.ptr == end;
+}
+
+// Open-addressing map from a category to its code. A column has few
+// distinct values, so this stays small and beats unordered_map's hashing
+// and node chasing by a wide margin.
+class CategoryIndex
+{
+    vector<int> slots; // code + 1, 0 when empty
+    size_t mask = 0;
+
+    static size_t hash(string_view key)
+    {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (char c : key)
+            h = (h ^ (unsigned char)c) * 0x100000001b3ULL;
+        return h ^ (h >> 29);
+    }
+
+public:
+    vector<string_view> names;
+
+    // The code of a known key, -1 otherwise.
+    int find(string_view key) const
+    {
+        if (slots.empty())
+            return -1;
+        size_t at = hash(key) & mask;
+        while (slots[at])
+        {
+            if (names[slots[at] - 1] == key)
+                return slots[at] - 1;
+            at = (at + 1) & mask;
+        }
+        return -1;
+    }
+
+    int code(string_view key)
+    {
+        if (names.size() * 2 >= slots.size())
+        {
+            slots.assign(max<size_t>(16, slots.size() * 2), 0);
+            mask = slots.size() - 1;
+            for (size_t k = 0; k < names.size(); k++)
+            {
+                size_t at = hash(names[k]) & mask;
+                while (slots[at])
+                    at = (at + 1) & mask;
+                slots[at] = k + 1;
+            }
+        }
+        size_t at = hash(key) & mask;
+        while (slots[at])
+        {
+            if (names[slots[at] - 1] == key)
+                return slots[at] - 1;
+            at = (at + 1) & mask;
+        }
+        names.push_back(key);
+        slots[at] = names.size();
+        return names.size() - 1;
+    }
+};
+
+// The rows of one chunk of the file. Categorical columns use codes local
+// to the chunk until the chunks are merged.
+struct CsvChunk
+{
+    vector<vector<float>> values;
+    vector<vector<int>> codes;
+    vector<CategoryIndex> categories;
+    int rows = 0;
+};
+
+inline void parse_chunk(const char *begin, const char *end, bool skip_first_col, const vector<bool> &numeric, CsvChunk &chunk)
+{
+    int columns = numeric.size();
+    chunk.values.assign(columns, {});
+    chunk.codes.assign(columns, {});
+    chunk.categories.assign(columns, {});
+    vector<string_view> fields;
+    while (begin < end)
+    {
+        const char *newline = (const char *)memchr(begin, '\n', end - begin);
+        const char *line_end = newline ? newline : end;
+        split_fields(string_view(begin, line_end - begin), skip_first_col, fields);
+        begin = line_end + 1;
+        if ((int)fields.size() != columns)
+            continue;
+        for (int i = 0; i < columns; i++)
+        {
+            if (numeric[i])
+            {
+                float value = 0;
+                if (!is_missing(fields[i]) && !parse_float(fields[i], value))
+                    value = 0;
+                chunk.values[i].push_back(value);
+            }
+            else
+                chunk.codes[i].push_back(chunk.categories[i].code(fields[i]));
+        }
+        chunk.rows++;
+    }
+}
+
+// Loads a CSV straight into typed columns. The file is memory-mapped and
+// tokenized in place. Column types come from the first SAMPLE_ROWS rows: a
+// column is numeric if every present value there is a number. Files over
+// CHUNK_BYTES are split at line breaks and parsed by several threads.
+inline Table load_csv(const string &csv, bool skip_first_col = true, bool header_exists = true,
+                      int threads = thread::hardware_concurrency())
+{
+    const int SAMPLE_ROWS = 1000;
+    const size_t CHUNK_BYTES = 16 << 20;
+    Table table;
+    int fd = open(csv.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "Error opening file: " << csv << endl;
+        return table;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        cerr << "No data found in file: " << csv << endl;
+        return table;
+    }
+    size_t size = info.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        cerr << "Error opening file: " << csv << endl;
+        return table;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char *data = (const char *)mapping, *end = data + size;
+
+    auto next_line = [&](const char *&at)
+    {
+        const char *newline = (const char *)memchr(at, '\n', end - at);
+        string_view line(at, (newline ? newline : end) - at);
+        at = newline ? newline + 1 : end;
+        return line;
+    };
+    const char *body = data;
+    vector<string_view> fields;
+    if (header_exists)
+    {
+        split_fields(next_line(body), skip_first_col, fields);
+        for (auto field : fields)
+            table.headers.push_back(string(field));
+    }
+
+    // column count and types from a sample
+    int columns = table.headers.size();
+    vector<bool> numeric;
+    vector<bool> seen;
+    const char *at = body;
+    for (int sampled = 0; sampled < SAMPLE_ROWS && at < end;)
+    {
+        string_view line = next_line(at);
+        split_fields(line, skip_first_col, fields);
+        if (line.find_first_not_of(" \t\r") == string_view::npos)
+            continue;
+        if (columns == 0)
+            columns = fields.size();
+        if ((int)fields.size() != columns)
+            continue;
+        if (numeric.empty())
+        {
+            numeric.assign(columns, true);
+            seen.assign(columns, false);
+        }
+        float value;
+        for (int i = 0; i < columns; i++)
+            if (!is_missing(fields[i]))
+            {
+                seen[i] = true;
+                if (!parse_float(fields[i], value))
+                    numeric[i] = false;
+            }
+        sampled++;
+    }
+    if (numeric.empty())
+    {
+        munmap(mapping, size);
+        cerr << "No data found in file: " << csv << endl;
+        return table;
+    }
+    for (int i = 0; i < columns; i++)
+        numeric[i] = numeric[i] && seen[i] && i < columns - 1;
+    if (!header_exists)
+    {
+        for (int i = 0; i < columns - 1; ++i)
+            table.headers.push_back("Feature" + to_string(i + 1));
+        table.headers.push_back("Label");
+    }
+
+    // chunks start right after a line break
+    int chunks = max(1, min(threads, (int)((end - body) / CHUNK_BYTES)));
+    vector<const char *> starts = {body};
+    for (int c = 1; c < chunks; c++)
+    {
+        const char *guess = body + (end - body) * c / chunks;
+        const char *newline = (const char *)memchr(guess, '\n', end - guess);
+        starts.push_back(newline ? max(starts.back(), newline + 1) : end);
+    }
+    starts.push_back(end);
+    vector<CsvChunk> parts(chunks);
+    vector<thread> workers;
+    for (int c = 1; c < chunks; c++)
+        workers.emplace_back(parse_chunk, starts[c], starts[c + 1], skip_first_col, cref(numeric), ref(parts[c]));
+    parse_chunk(starts[0], starts[1], skip_first_col, numeric, parts[0]);
+    for (auto &worker : workers)
+        worker.join();
+
+    // merge the chunks; categories are sorted, so codes follow string order
+    table.columns.resize(columns);
+    for (auto &part : parts)
+        table.rows += part.rows;
+    for (int i = 0; i < columns; i++)
+    {
+        Column &column = table.columns[i];
+        column.numeric = numeric[i];
+        if (numeric[i])
+        {
+            column.values.reserve(table.rows);
+            for (auto &part : parts)
+                column.values.insert(column.values.end(), part.values[i].begin(), part.values[i].end());
+            continue;
+        }
+        vector<string_view> names;
+        for (auto &part : parts)
+            names.insert(names.end(), part.categories[i].names.begin(), part.categories[i].names.end());
+        sort(names.begin(), names.end());
+        names.erase(unique(names.begin(), names.end()), names.end());
+        column.categories.assign(names.begin(), names.end());
+        column.codes.reserve(table.rows);
+        for (auto &part : parts)
+        {
+            const vector<string_view> &local = part.categories[i].names;
+            vector<int> code_of(local.size());
+            for (size_t k = 0; k < local.size(); k++)
+                code_of[k] = lower_bound(names.begin(), names.end(), local[k]) - names.begin();
+            for (int code : part.codes[i])
+                column.codes.push_back(code_of[code]);
+        }
+    }
+    munmap(mapping, size);
+    if (table.rows == 0)
+        cerr << "No data found in file: " << csv << endl;
+    return table;
+}
+
+
+// Calls visit(line) for every line of a stream, e.g. a pipe, without the
+// line break. Reads in large blocks and keeps only the unfinished line
+// between them, so memory does not grow with the input.
+template <typename Visit>
+void for_each_line(FILE *in, Visit visit)
+{
+    const size_t READ_BYTES = 1 << 20;
+    vector<char> buffer;
+    size_t used = 0;
+    bool done = false;
+    while (!done)
+    {
+        buffer.resize(used + READ_BYTES);
+        size_t got = fread(buffer.data() + used, 1, READ_BYTES, in);
+        done = got == 0;
+        used += got;
+        // whole lines only, except for a last line without a line break
+        const char *at = buffer.data(), *end = at + used;
+        const char *stop = done ? end : at;
+        if (!done)
+            for (const char *p = end; p > at; p--)
+                if (p[-1] == '\n')
+                {
+                    stop = p;
+                    break;
+                }
+        while (at < stop)
+        {
+            const char *newline = (const char *)memchr(at, '\n', stop - at);
+            const char *line_end = newline ? newline : stop;
+            visit(string_view(at, line_end - at));
+            at = newline ? newline + 1 : stop;
+        }
+        used = end - stop;
+        memmove(buffer.data(), stop, used);
+    }
+}
+
+#endif
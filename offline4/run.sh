@@ -1,3 +1,3 @@
-g++ tree.cpp -o test
+g++ -O2 -march=native -pthread tree.cpp -o test
 ./test IG 3
 rm test
\ No newline at end of file
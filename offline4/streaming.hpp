@@ -0,0 +1,349 @@
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+
+#include <deque>
+#include "tree.hpp"
+using namespace std;
+
+// A decision tree learned from rows read once from a stream (a Hoeffding
+// tree). Every learning leaf keeps class counts per feature bin. After each
+// GRACE_PERIOD rows it tries its best split with the tree's criterion and
+// takes it once the Hoeffding bound says the best feature beats the
+// runner-up with probability 1 - DELTA, or the two are too close to matter.
+//
+// Bins come from the first SAMPLE_ROWS rows: quantile edges for numeric
+// features, one bin per category (in order of appearance, code 0 for the
+// ones past MAX_CATEGORIES) for the others. Counts live in slots that
+// together fit in MaxBytes; leaves without a slot stop learning, so memory
+// does not grow with the stream.
+class HoeffdingTree
+{
+    struct StreamNode
+    {
+        int feature_index; // -1 at leaves
+        float threshold;
+        int bin;   // rows with a bin up to this one go left
+        int label; // majority class of the rows seen here
+        StreamNode *left, *right;
+        int depth;
+        int slot; // index into slots, -1 when not learning
+        vector<int> class_count;
+        // rows so far, capped at LEAF_ROWS so no count overflows, and at the
+        // last split attempt
+        int seen, checked;
+        CategorySet categories; // always empty: codes are split by bin
+    };
+
+    int MaxDepth;
+    size_t MaxBytes;
+    Tree scorer; // only for its criterion
+
+    static const int SAMPLE_ROWS = 10000;
+    static const int NUMERIC_BINS = 64;
+    static const int MAX_CATEGORIES = 64;
+    static const int GRACE_PERIOD = 200;
+    static const int LEAF_ROWS = 1 << 30;
+    static constexpr double DELTA = 1e-7;
+    static constexpr double TIE = 0.05;
+
+    vector<string> headers;
+    vector<bool> numeric;
+    vector<vector<float>> edges;           // numeric features
+    vector<CategoryIndex> categories;      // categorical features
+    vector<deque<string>> category_names;  // what their string_views point at
+    vector<string> classes;
+    CategoryIndex class_index;
+    vector<int> bin_offsets;
+
+    deque<StreamNode> nodes;
+    vector<vector<int>> slots; // (bin, class) counts of learning leaves
+    vector<int> free_slots;
+    size_t max_slots;
+
+    long long rows_seen, rows_skipped, correct;
+    vector<vector<string>> sample;
+    vector<int> row_bins;
+    FlatTree flat;
+
+    int features() const { return numeric.size(); }
+
+    int bin_of(int i, string_view field)
+    {
+        if (!numeric[i])
+        {
+            int code = categories[i].find(field);
+            if (code < 0 && (int)categories[i].names.size() < MAX_CATEGORIES - 1)
+            {
+                category_names[i].emplace_back(field);
+                code = categories[i].code(category_names[i].back());
+            }
+            return code + 1;
+        }
+        float value = 0;
+        if (!is_missing(field) && !parse_float(field, value))
+            value = 0;
+        return lower_bound(edges[i].begin(), edges[i].end(), value) - edges[i].begin();
+    }
+
+    // Column types, bins and classes from the sampled rows.
+    void setup()
+    {
+        int columns = sample[0].size();
+        numeric.assign(columns - 1, true);
+        vector<bool> present(columns - 1, false);
+        float value;
+        for (const auto &row : sample)
+            for (int i = 0; i < columns - 1; i++)
+                if (!is_missing(row[i]))
+                {
+                    present[i] = true;
+                    if (!parse_float(row[i], value))
+                        numeric[i] = false;
+                }
+        edges.assign(features(), {});
+        categories.assign(features(), CategoryIndex());
+        category_names.assign(features(), {});
+        bin_offsets.assign(features() + 1, 0);
+        for (int i = 0; i < features(); i++)
+        {
+            numeric[i] = numeric[i] && present[i];
+            if (numeric[i])
+            {
+                vector<float> values;
+                for (const auto &row : sample)
+                    values.push_back(is_missing(row[i]) || !parse_float(row[i], value) ? 0 : value);
+                edges[i] = bin_edges(values, NUMERIC_BINS);
+            }
+            bin_offsets[i + 1] = bin_offsets[i] + (numeric[i] ? edges[i].size() + 1 : MAX_CATEGORIES);
+        }
+        if (headers.empty())
+        {
+            for (int i = 0; i < features(); ++i)
+                headers.push_back("Feature" + to_string(i + 1));
+            headers.push_back("Label");
+        }
+
+        for (const auto &row : sample)
+            classes.push_back(row.back());
+        sort(classes.begin(), classes.end());
+        classes.erase(unique(classes.begin(), classes.end()), classes.end());
+        for (const string &name : classes)
+            class_index.code(name);
+
+        size_t slot_bytes = bin_offsets.back() * classes.size() * sizeof(int);
+        max_slots = max<size_t>(1, MaxBytes / slot_bytes);
+        nodes.push_back(new_leaf(vector<int>(classes.size(), 0), 0));
+        row_bins.resize(features());
+    }
+
+    StreamNode new_leaf(const vector<int> &class_count, int depth)
+    {
+        StreamNode leaf = {-1, 0.0f, 0, 0, nullptr, nullptr, depth, -1, class_count, 0, 0, {}};
+        leaf.label = max_element(class_count.begin(), class_count.end()) - class_count.begin();
+        leaf.seen = leaf.checked = accumulate(class_count.begin(), class_count.end(), 0);
+        if (depth > MaxDepth)
+            return leaf;
+        if (!free_slots.empty())
+        {
+            leaf.slot = free_slots.back();
+            free_slots.pop_back();
+            slots[leaf.slot].assign(bin_offsets.back() * classes.size(), 0);
+        }
+        else if (slots.size() < max_slots)
+        {
+            leaf.slot = slots.size();
+            slots.emplace_back(bin_offsets.back() * classes.size(), 0);
+        }
+        return leaf;
+    }
+
+    void learn_row(const vector<string_view> &fields)
+    {
+        int label = class_index.find(fields.back());
+        if ((int)fields.size() != features() + 1 || label < 0)
+        {
+            rows_skipped++;
+            return;
+        }
+        for (int i = 0; i < features(); i++)
+            row_bins[i] = bin_of(i, fields[i]);
+        StreamNode *at = &nodes[0];
+        while (at->feature_index != -1)
+            at = row_bins[at->feature_index] <= at->bin ? at->left : at->right;
+
+        // each row is predicted before it is learned from
+        rows_seen++;
+        correct += at->label == label;
+        if (at->seen == LEAF_ROWS)
+            return;
+        at->seen++;
+        int count = ++at->class_count[label];
+        if (count > at->class_count[at->label] || (count == at->class_count[at->label] && label < at->label))
+            at->label = label;
+        if (at->slot < 0)
+            return;
+        int *counts = slots[at->slot].data();
+        int num_classes = classes.size();
+        for (int i = 0; i < features(); i++)
+            counts[(bin_offsets[i] + row_bins[i]) * num_classes + label]++;
+        if (at->seen - at->checked >= GRACE_PERIOD)
+            try_split(at);
+    }
+
+    void try_split(StreamNode *leaf)
+    {
+        leaf->checked = leaf->seen;
+        int num_classes = classes.size();
+        // only the rows since the leaf was made are in its bins
+        const int *counts = slots[leaf->slot].data();
+        vector<int> parent(num_classes, 0), left(num_classes), right(num_classes);
+        for (int b = bin_offsets[0]; b < bin_offsets[1]; b++)
+            for (int c = 0; c < num_classes; c++)
+                parent[c] += counts[b * num_classes + c];
+        if (count(parent.begin(), parent.end(), 0) >= num_classes - 1)
+            return;
+        int size = accumulate(parent.begin(), parent.end(), 0);
+        double best = 0.0, second = 0.0;
+        int best_feature = -1, best_bin = -1;
+        for (int i = 0; i < features(); i++)
+        {
+            double feature_best = 0.0;
+            int feature_bin = -1;
+            fill(left.begin(), left.end(), 0);
+            for (int b = 0; b < bin_offsets[i + 1] - bin_offsets[i] - 1; b++)
+            {
+                const int *in_bin = counts + (bin_offsets[i] + b) * num_classes;
+                int added = 0;
+                for (int c = 0; c < num_classes; c++)
+                {
+                    left[c] += in_bin[c];
+                    added += in_bin[c];
+                }
+                if (added == 0)
+                    continue;
+                for (int c = 0; c < num_classes; c++)
+                    right[c] = parent[c] - left[c];
+                double gain = scorer.score(parent, left, right);
+                if (gain > feature_best)
+                {
+                    feature_best = gain;
+                    feature_bin = b;
+                }
+            }
+            if (feature_best > best)
+            {
+                second = best;
+                best = feature_best;
+                best_feature = i;
+                best_bin = feature_bin;
+            }
+            else if (feature_best > second)
+                second = feature_best;
+        }
+        double range = log2((double)num_classes);
+        double bound = sqrt(range * range * log(1 / DELTA) / (2.0 * size));
+        if (best_feature == -1 || (best - second <= bound && bound >= TIE))
+            return;
+
+        fill(left.begin(), left.end(), 0);
+        for (int b = 0; b <= best_bin; b++)
+            for (int c = 0; c < num_classes; c++)
+                left[c] += counts[(bin_offsets[best_feature] + b) * num_classes + c];
+        for (int c = 0; c < num_classes; c++)
+            right[c] = parent[c] - left[c];
+        free_slots.push_back(leaf->slot);
+        leaf->slot = -1;
+        leaf->feature_index = best_feature;
+        leaf->bin = best_bin;
+        leaf->threshold = numeric[best_feature] ? edges[best_feature][best_bin] : best_bin;
+        nodes.push_back(new_leaf(left, leaf->depth + 1));
+        leaf->left = &nodes.back();
+        nodes.push_back(new_leaf(right, leaf->depth + 1));
+        leaf->right = &nodes.back();
+    }
+
+public:
+    HoeffdingTree(int MaxDepth, string criterion = "IG", size_t MaxBytes = 64 << 20)
+        : MaxDepth(MaxDepth), MaxBytes(MaxBytes), scorer(MaxDepth, criterion)
+    {
+        rows_seen = rows_skipped = correct = 0;
+        max_slots = 0;
+    }
+
+    // Learns from every row of a CSV stream, the last column being the
+    // label. Rows with another field count or a label missing from the
+    // sample are skipped and counted in get_skipped.
+    void learn(FILE *in, bool skip_first_col = false, bool header_exists = false)
+    {
+        vector<string_view> fields;
+        bool first = true;
+        for_each_line(in, [&](string_view line)
+                      {
+            split_fields(line, skip_first_col, fields);
+            if (line.find_first_not_of(" \t\r") == string_view::npos)
+                return;
+            if (first && header_exists)
+            {
+                first = false;
+                for (auto field : fields)
+                    headers.push_back(string(field));
+                return;
+            }
+            first = false;
+            if (nodes.empty())
+            {
+                if (!sample.empty() && fields.size() != sample[0].size())
+                {
+                    rows_skipped++;
+                    return;
+                }
+                sample.emplace_back(fields.begin(), fields.end());
+                if ((int)sample.size() == SAMPLE_ROWS)
+                    learn_sample();
+                return;
+            }
+            learn_row(fields); });
+        if (nodes.empty() && !sample.empty())
+            learn_sample();
+        flat = FlatTree(nodes.empty() ? nullptr : &nodes[0], features());
+    }
+
+    void learn_sample()
+    {
+        setup();
+        vector<string_view> fields;
+        for (const auto &row : sample)
+        {
+            fields.assign(row.begin(), row.end());
+            learn_row(fields);
+        }
+        sample = vector<vector<string>>();
+    }
+
+    long long get_rows() const { return rows_seen; }
+    long long get_skipped() const { return rows_skipped; }
+    int get_nodes() const { return nodes.size(); }
+    int get_learning_leaves() const { return slots.size() - free_slots.size(); }
+
+    // Accuracy of predicting each row just before learning from it.
+    double get_prequential_accuracy() const
+    {
+        return rows_seen ? (double)correct / rows_seen : 0.0;
+    }
+
+    // Writes the tree learned so far for Model::load. Categories map to
+    // their bin codes, so unseen ones fall in bin 0 as while learning.
+    bool save(const string &path) const
+    {
+        vector<map<string, int>> mappers(features());
+        for (int i = 0; i < features(); i++)
+            for (size_t k = 0; k < category_names[i].size(); k++)
+                mappers[i][category_names[i][k]] = k + 1;
+        vector<bool> categorical(features());
+        for (int i = 0; i < features(); i++)
+            categorical[i] = !numeric[i];
+        return save_model(path, headers, mappers, categorical, classes, {&flat});
+    }
+};
+
+#endif
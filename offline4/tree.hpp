@@ -0,0 +1,963 @@
+#ifndef TREE_HPP
+#define TREE_HPP
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <time.h>
+#include "parser.hpp"
+#include "dataset.hpp"
+#include "parallel.hpp"
+#include "flat_tree.hpp"
+#include "model.hpp"
+using namespace std;
+
+// splitmix64, used to give every node of a randomized tree its own seed
+inline uint64_t mix_seed(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+struct Split
+{
+    int feature_index;
+    double threshold;
+    double gain;
+    CategorySet categories; // codes going left; empty for a threshold split
+    Split() : feature_index(-1), gain(0.0) {}
+    Split(int feature_index, double threshold, double gain) : feature_index(feature_index), threshold(threshold), gain(gain) {}
+};
+
+class node
+{
+public:
+    int feature_index;
+    double threshold;
+    string value;
+    int label; // index of value in the training classes
+    double gain;
+    CategorySet categories; // as in Split
+    node *left, *right;
+
+    node() : label(-1), left(nullptr), right(nullptr) {}
+    node(int feature_index, double threshold, double gain, string value, int label = -1) : feature_index(feature_index), threshold(threshold), value(value), label(label), gain(gain), left(nullptr), right(nullptr) {}
+};
+
+class Tree
+{
+    // scores a split from the class counts of the parent and both children
+    typedef double (Tree::*Criterion_func)(const vector<int> &, const vector<int> &, const vector<int> &);
+    vector<map<string, int>> mappers;
+    int MaxDepth;
+    int MinSamplesSplit;
+    vector<bool> isCategorical;
+    vector<string> classes;
+    string criterion;
+    Criterion_func evaluate;
+
+    // row indices of the training set, one copy per feature sorted by that
+    // feature; every node owns the same [begin, end) range in all of them
+    vector<vector<int>> sorted;
+    vector<vector<int>> buffers; // same shape, scratch for split_data
+    vector<char> goes_left;
+
+    // histogram mode: counts per (feature, bin, class), feature i's bins
+    // starting at bin_offsets[i]
+    bool histogram;
+    bool native_categorical; // split categorical features by category sets
+    vector<int> bin_offsets;
+    const vector<int> *weights; // times each row was sampled; null means once
+    int max_features;           // features tried per split, 0 for all
+
+    // Nodes with at least PARALLEL_ROWS rows scan their features on several
+    // threads and hand one child to another thread. The tree is the same as
+    // a serial build's: per-feature results are combined in feature order.
+    static const int PARALLEL_ROWS = 4096;
+    int threads;
+    ThreadBudget budget;
+
+public:
+    node *root;
+    FlatTree flat; // compiled from root after every fit
+    Tree() : histogram(false), native_categorical(true), weights(nullptr), max_features(0), threads(thread::hardware_concurrency()), root(nullptr) {}
+    Tree(int MaxDepth, string criterion = "IG", int MinSamplesSplit = 2) : MaxDepth(MaxDepth), MinSamplesSplit(MinSamplesSplit), root(nullptr), criterion(criterion)
+    {
+        histogram = false;
+        native_categorical = true;
+        weights = nullptr;
+        max_features = 0;
+        threads = max(1u, thread::hardware_concurrency());
+        if (criterion == "IG")
+            this->evaluate = &Tree::IG;
+        else if (criterion == "IGR")
+            this->evaluate = &Tree::IGR;
+        else if (criterion == "NWIG")
+            this->evaluate = &Tree::NWIG;
+        else
+            this->evaluate = &Tree::IG;
+    }
+
+    // Trains on features quantized to at most Dataset::MAX_BINS bins instead
+    // of every distinct value.
+    void set_histogram(bool enabled)
+    {
+        histogram = enabled;
+    }
+
+    void set_threads(int count)
+    {
+        threads = max(1, count);
+    }
+
+    // With native categorical splits off, category codes are compared with
+    // thresholds like numbers.
+    void set_native_categorical(bool enabled)
+    {
+        native_categorical = enabled;
+    }
+
+    const vector<string> &get_classes() const { return classes; }
+    const vector<map<string, int>> &get_mappers() const { return mappers; }
+    const vector<bool> &get_categorical() const { return isCategorical; }
+
+    // Writes the trained tree for Model::load; `headers` names the features
+    // and, last, the label.
+    bool save(const string &path, const vector<string> &headers) const
+    {
+        return save_model(path, headers, mappers, isCategorical, classes, {&flat});
+    }
+
+    // Builds the categorical mappers from the training rows and encodes them.
+    Dataset prepare(vector<vector<string>> &data, vector<string> &headers)
+    {
+        isCategorical.clear();
+        isCategorical.resize(headers.size() - 1, false);
+        mappers_init(data, headers);
+        return preprocessor(data, headers);
+    }
+
+    // The same for some rows of a loaded table. Its categories become the
+    // mappers, so training and test rows share one encoding.
+    Dataset prepare(const Table &table, const vector<int> &rows)
+    {
+        int features = table.features();
+        isCategorical.assign(features, false);
+        mappers.assign(features, map<string, int>());
+        Dataset dataset;
+        dataset.columns.assign(features, vector<float>(rows.size()));
+        dataset.categorical.assign(features, 0);
+        for (int i = 0; i < features; i++)
+        {
+            const Column &column = table.columns[i];
+            vector<float> &values = dataset.columns[i];
+            if (column.numeric)
+            {
+                for (size_t r = 0; r < rows.size(); r++)
+                    values[r] = column.values[rows[r]];
+                continue;
+            }
+            isCategorical[i] = true;
+            dataset.categorical[i] = native_categorical;
+            for (size_t k = 0; k < column.categories.size(); k++)
+                mappers[i][column.categories[k]] = k;
+            for (size_t r = 0; r < rows.size(); r++)
+                values[r] = column.codes[rows[r]];
+        }
+        const Column &label = table.columns.back();
+        dataset.classes = label.categories;
+        dataset.labels.resize(rows.size());
+        for (size_t r = 0; r < rows.size(); r++)
+            dataset.labels[r] = label.codes[rows[r]];
+        return dataset;
+    }
+
+    void fit(vector<vector<string>> &data, vector<string> &headers)
+    {
+        Dataset dataset = prepare(data, headers);
+        fit(dataset);
+    }
+
+    void fit(const Table &table, const vector<int> &rows)
+    {
+        Dataset dataset = prepare(table, rows);
+        fit(dataset);
+    }
+
+    void fit(Dataset &dataset)
+    {
+        if (histogram)
+        {
+            if (dataset.bins.empty())
+                dataset.build_bins();
+            fit_histogram(dataset, vector<int>(dataset.size(), 1));
+            return;
+        }
+
+        classes = dataset.classes;
+        budget.reset(threads);
+
+        // sort once; splitting a node keeps each of its ranges sorted
+        sorted.assign(dataset.features(), vector<int>(dataset.size()));
+        buffers.assign(dataset.features(), vector<int>(dataset.size()));
+        parallel_for(dataset.features(), threads - 1, [&](int i)
+                     {
+            const vector<float> &column = dataset.columns[i];
+            iota(sorted[i].begin(), sorted[i].end(), 0);
+            stable_sort(sorted[i].begin(), sorted[i].end(), [&](int a, int b)
+                        { return column[a] < column[b]; }); });
+        goes_left.assign(dataset.size(), 0);
+        root = build_tree(dataset, 0, dataset.size(), 0);
+        flat = FlatTree(root, dataset.features());
+        sorted.clear();
+        buffers.clear();
+        goes_left.clear();
+    }
+
+    // Histogram training on a weighted sample of an already binned dataset:
+    // row r counts sample_weights[r] times and rows of weight 0 are left
+    // out. With features_per_split > 0 each split only looks at that many
+    // features, drawn with a per-node seed derived from `seed` so the tree
+    // does not depend on thread timing.
+    void fit_histogram(const Dataset &dataset, const vector<int> &sample_weights, int features_per_split = 0, uint64_t seed = 0)
+    {
+        classes = dataset.classes;
+        budget.reset(threads);
+        weights = &sample_weights;
+        max_features = features_per_split;
+        bin_offsets.assign(dataset.features() + 1, 0);
+        for (int i = 0; i < dataset.features(); i++)
+            bin_offsets[i + 1] = bin_offsets[i] + dataset.edges[i].size();
+        vector<int> rows;
+        for (int r = 0; r < dataset.size(); r++)
+            if (sample_weights[r] > 0)
+                rows.push_back(r);
+        vector<int> hist;
+        class_histogram(dataset, rows.data(), rows.data() + rows.size(), hist);
+        root = build_tree_histogram(dataset, rows.data(), rows.data() + rows.size(), 0, hist, seed);
+        flat = FlatTree(root, dataset.features());
+        weights = nullptr;
+    }
+
+    // Threads to add to the caller's for `tasks` independent pieces of work
+    // on a node of `rows` rows. Hand them back with budget.give_back.
+    int take_helpers(int rows, int tasks)
+    {
+        return rows >= PARALLEL_ROWS && tasks > 1 ? budget.take(tasks - 1) : 0;
+    }
+
+    // Builds the left child on another thread when both children are big
+    // enough and a thread is free.
+    template <typename Left, typename Right>
+    void build_children(node *parent, int smaller_child, Left build_left, Right build_right)
+    {
+        if (smaller_child >= PARALLEL_ROWS && budget.take(1))
+        {
+            thread worker([&]()
+                          { parent->left = build_left(); });
+            parent->right = build_right();
+            worker.join();
+            budget.give_back(1);
+        }
+        else
+        {
+            parent->left = build_left();
+            parent->right = build_right();
+        }
+    }
+
+    // Builds the subtree for the rows whose indices are in [begin, end),
+    // given their class histogram. Only the smaller child's histogram is
+    // counted; the other one is the parent's minus it.
+    node *build_tree_histogram(const Dataset &data, int *begin, int *end, int depth, const vector<int> &hist, uint64_t seed)
+    {
+        if (begin == end)
+            return nullptr;
+        if (depth <= MaxDepth && end - begin >= MinSamplesSplit)
+        {
+            auto best_split = get_best_bin_split(data, hist, seed);
+            if (best_split.feature_index != -1 && best_split.gain > 0)
+            {
+                const vector<float> &column = data.columns[best_split.feature_index];
+                int *mid = partition(begin, end, [&](int row)
+                                     { return sends_left(best_split, column[row]); });
+                bool left_smaller = mid - begin <= end - mid;
+                vector<int> left_hist, right_hist;
+                vector<int> &small = left_smaller ? left_hist : right_hist;
+                vector<int> &large = left_smaller ? right_hist : left_hist;
+                if (left_smaller)
+                    class_histogram(data, begin, mid, small);
+                else
+                    class_histogram(data, mid, end, small);
+                large.resize(hist.size());
+                for (size_t k = 0; k < hist.size(); k++)
+                    large[k] = hist[k] - small[k];
+
+                node *new_node = new node(best_split.feature_index, best_split.threshold, best_split.gain, "");
+                new_node->categories = move(best_split.categories);
+                build_children(
+                    new_node, min(mid - begin, end - mid),
+                    [&]()
+                    { return build_tree_histogram(data, begin, mid, depth + 1, left_hist, mix_seed(2 * seed + 1)); },
+                    [&]()
+                    { return build_tree_histogram(data, mid, end, depth + 1, right_hist, mix_seed(2 * seed + 2)); });
+                return new_node;
+            }
+        }
+        return leaf(data, begin, end);
+    }
+
+    void class_histogram(const Dataset &data, const int *begin, const int *end, vector<int> &hist)
+    {
+        int classes = data.num_classes();
+        hist.assign(bin_offsets.back() * classes, 0);
+        const int *weight = weights->data();
+        int helpers = take_helpers(end - begin, data.features());
+        parallel_for(data.features(), helpers, [&](int i)
+                     {
+            const vector<uint8_t> &bins = data.bins[i];
+            int *counts = hist.data() + bin_offsets[i] * classes;
+            for (const int *row = begin; row != end; row++)
+                counts[bins[*row] * classes + data.labels[*row]] += weight[*row]; });
+        budget.give_back(helpers);
+    }
+
+    Split get_best_bin_split(const Dataset &data, const vector<int> &hist, uint64_t seed)
+    {
+        int classes = data.num_classes();
+        vector<int> parent(classes, 0);
+        for (int b = bin_offsets[0]; b < bin_offsets[1]; b++)
+            for (int c = 0; c < classes; c++)
+                parent[c] += hist[b * classes + c];
+        int size = accumulate(parent.begin(), parent.end(), 0);
+
+        vector<char> tried(data.features(), 1);
+        if (max_features > 0 && max_features < data.features())
+        {
+            vector<int> order(data.features());
+            iota(order.begin(), order.end(), 0);
+            mt19937_64 rng(seed);
+            for (int k = 0; k < max_features; k++)
+                swap(order[k], order[k + rng() % (data.features() - k)]);
+            fill(tried.begin(), tried.end(), 0);
+            for (int k = 0; k < max_features; k++)
+                tried[order[k]] = 1;
+        }
+
+        vector<Split> splits(data.features());
+        int helpers = take_helpers(size, data.features());
+        parallel_for(data.features(), helpers, [&](int i)
+                     {
+            if (tried[i])
+                splits[i] = best_bin_split_on(data, i, hist, parent, size); });
+        budget.give_back(helpers);
+        return best_of(splits);
+    }
+
+    // Same sweep as best_split_on, one bin at a time. Empty bins are
+    // skipped so the threshold is always a value present in the node.
+    Split best_bin_split_on(const Dataset &data, int feature_index, const vector<int> &hist, const vector<int> &parent, int size)
+    {
+        if (data.is_categorical(feature_index))
+        {
+            // a bin holds the codes in (edges[b - 1], edges[b]], bin 0 all
+            // codes up to edges[0]
+            int classes = data.num_classes();
+            const vector<float> &edge = data.edges[feature_index];
+            vector<int> counts;
+            vector<pair<int, int>> codes;
+            for (int b = 0; b < (int)edge.size(); b++)
+            {
+                const int *in_bin = hist.data() + (bin_offsets[feature_index] + b) * classes;
+                if (all_of(in_bin, in_bin + classes, [](int count)
+                           { return count == 0; }))
+                    continue;
+                counts.insert(counts.end(), in_bin, in_bin + classes);
+                codes.push_back({b ? (int)floor(edge[b - 1]) + 1 : 0, (int)edge[b]});
+            }
+            return best_subset_split(feature_index, counts, codes, parent);
+        }
+        double best_gain = -numeric_limits<double>::max();
+        Split best_split;
+
+        int classes = data.num_classes();
+        vector<int> left(classes, 0), right(classes);
+        int left_size = 0;
+        for (int b = bin_offsets[feature_index]; b < bin_offsets[feature_index + 1]; b++)
+        {
+            const int *counts = hist.data() + b * classes;
+            int in_bin = 0;
+            for (int c = 0; c < classes; c++)
+            {
+                left[c] += counts[c];
+                in_bin += counts[c];
+            }
+            left_size += in_bin;
+            if (in_bin == 0)
+                continue;
+            if (left_size == size)
+                break;
+            for (int c = 0; c < classes; c++)
+                right[c] = parent[c] - left[c];
+            double gain = (this->*evaluate)(parent, left, right);
+            if (gain > best_gain)
+            {
+                best_gain = gain;
+                best_split = Split(feature_index, data.edges[feature_index][b - bin_offsets[feature_index]], gain);
+            }
+        }
+
+        return best_split;
+    }
+
+    static bool sends_left(const Split &split, float value)
+    {
+        if (split.categories.empty())
+            return value <= split.threshold;
+        return in_category_set(split.categories.data(), split.categories.size(), value);
+    }
+
+    // Best split of a categorical feature into two sets of groups, where
+    // group g holds the codes codes[g].first..second and its class counts
+    // start at counts[g * classes]. Sorting the groups by the share of one
+    // class makes the best split for two classes a prefix of that order, so
+    // only the prefixes are tried. With more classes the share of the
+    // parent's majority class gives the order.
+    Split best_subset_split(int feature_index, const vector<int> &counts, const vector<pair<int, int>> &codes, const vector<int> &parent)
+    {
+        int classes = parent.size(), groups = codes.size();
+        int target = classes == 2 ? 1 : max_element(parent.begin(), parent.end()) - parent.begin();
+        vector<double> share(groups);
+        for (int g = 0; g < groups; g++)
+        {
+            const int *in_group = counts.data() + g * classes;
+            share[g] = (double)in_group[target] / accumulate(in_group, in_group + classes, 0);
+        }
+        vector<int> order(groups);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](int a, int b)
+                    { return share[a] < share[b]; });
+
+        double best_gain = -numeric_limits<double>::max();
+        int best_prefix = 0;
+        vector<int> left(classes, 0), right(classes);
+        for (int k = 0; k < groups - 1; k++)
+        {
+            const int *in_group = counts.data() + order[k] * classes;
+            for (int c = 0; c < classes; c++)
+            {
+                left[c] += in_group[c];
+                right[c] = parent[c] - left[c];
+            }
+            double gain = (this->*evaluate)(parent, left, right);
+            if (gain > best_gain)
+            {
+                best_gain = gain;
+                best_prefix = k + 1;
+            }
+        }
+        if (best_prefix == 0)
+            return Split();
+        Split best_split(feature_index, 0.0, best_gain);
+        for (int k = 0; k < best_prefix; k++)
+            for (int code = codes[order[k]].first; code <= codes[order[k]].second; code++)
+                add_to_category_set(best_split.categories, code);
+        return best_split;
+    }
+
+    // The first feature with the highest gain, as a serial scan would pick.
+    Split best_of(const vector<Split> &splits)
+    {
+        Split best_split;
+        for (const Split &split : splits)
+            if (split.feature_index != -1 && (best_split.feature_index == -1 || split.gain > best_split.gain))
+                best_split = split;
+        return best_split;
+    }
+
+    // Builds the subtree for the rows at positions [begin, end) of the
+    // sorted index arrays.
+    node *build_tree(const Dataset &data, int begin, int end, int depth)
+    {
+        if (begin == end || data.features() == 0)
+            return nullptr;
+        if (depth <= MaxDepth && end - begin >= MinSamplesSplit)
+        {
+            auto best_split = get_best_split(data, begin, end);
+            if (best_split.feature_index != -1 && best_split.gain > 0)
+            {
+                int mid = split_data(data, begin, end, best_split);
+                node *new_node = new node(best_split.feature_index, best_split.threshold, best_split.gain, "");
+                new_node->categories = move(best_split.categories);
+                build_children(
+                    new_node, min(mid - begin, end - mid),
+                    [&]()
+                    { return build_tree(data, begin, mid, depth + 1); },
+                    [&]()
+                    { return build_tree(data, mid, end, depth + 1); });
+                return new_node;
+            }
+        }
+        return leaf(data, sorted[0].data() + begin, sorted[0].data() + end);
+    }
+
+    Split get_best_split(const Dataset &data, int begin, int end)
+    {
+        vector<int> parent(data.num_classes(), 0);
+        for (int k = begin; k < end; k++)
+            parent[data.labels[sorted[0][k]]]++;
+        vector<Split> splits(data.features());
+        int helpers = take_helpers(end - begin, data.features());
+        parallel_for(data.features(), helpers, [&](int i)
+                     { splits[i] = best_split_on(data, i, begin, end, parent); });
+        budget.give_back(helpers);
+        return best_of(splits);
+    }
+
+    // Sweeps one feature in sorted order, moving one row at a time from the
+    // right class counts to the left ones. Each boundary between two
+    // distinct values is a candidate threshold.
+    Split best_split_on(const Dataset &data, int feature_index, int begin, int end, const vector<int> &parent)
+    {
+        double best_gain = -numeric_limits<double>::max();
+        Split best_split;
+
+        const vector<float> &column = data.columns[feature_index];
+        const vector<int> &rows = sorted[feature_index];
+        if (data.is_categorical(feature_index))
+        {
+            // rows with the same code are next to each other
+            int classes = data.num_classes();
+            vector<int> counts;
+            vector<pair<int, int>> codes;
+            for (int k = begin; k < end; k++)
+            {
+                int code = column[rows[k]];
+                if (codes.empty() || codes.back().first != code)
+                {
+                    codes.push_back({code, code});
+                    counts.resize(counts.size() + classes, 0);
+                }
+                counts[counts.size() - classes + data.labels[rows[k]]]++;
+            }
+            return best_subset_split(feature_index, counts, codes, parent);
+        }
+        vector<int> left(data.num_classes(), 0), right(data.num_classes());
+        for (int k = begin; k < end - 1; k++)
+        {
+            left[data.labels[rows[k]]]++;
+            if (column[rows[k + 1]] == column[rows[k]])
+                continue;
+            for (int c = 0; c < data.num_classes(); c++)
+                right[c] = parent[c] - left[c];
+            double gain = (this->*evaluate)(parent, left, right);
+            if (gain > best_gain)
+            {
+                best_gain = gain;
+                best_split = Split(feature_index, column[rows[k]], gain);
+            }
+        }
+
+        return best_split;
+    }
+
+    // Moves the rows that go left to the front of the range in every sorted
+    // array, keeping both parts sorted, and returns where the rest start.
+    int split_data(const Dataset &data, int begin, int end, const Split &split)
+    {
+        int feature_index = split.feature_index;
+        const vector<float> &column = data.columns[feature_index];
+        const vector<int> &by_feature = sorted[feature_index];
+        int mid = begin;
+        bool by_set = !split.categories.empty();
+        if (by_set)
+        {
+            for (int k = begin; k < end; k++)
+                if (sends_left(split, column[by_feature[k]]))
+                {
+                    goes_left[by_feature[k]] = 1;
+                    mid++;
+                }
+        }
+        else
+        {
+            // a threshold's left rows are already in front
+            while (mid < end && column[by_feature[mid]] <= split.threshold)
+                goes_left[by_feature[mid++]] = 1;
+        }
+        int helpers = take_helpers(end - begin, data.features());
+        parallel_for(data.features(), helpers, [&](int i)
+                     {
+            if (i == feature_index && !by_set)
+                return;
+            vector<int> &rows = sorted[i];
+            vector<int> &buffer = buffers[i];
+            int l = begin, r = begin;
+            for (int k = begin; k < end; k++)
+            {
+                if (goes_left[rows[k]])
+                    rows[l++] = rows[k];
+                else
+                    buffer[r++] = rows[k];
+            }
+            copy(buffer.begin() + begin, buffer.begin() + r, rows.begin() + l); });
+        budget.give_back(helpers);
+        for (int k = begin; k < mid; k++)
+            goes_left[sorted[feature_index][k]] = 0;
+        return mid;
+    }
+
+    // The configured criterion for a split with these class counts.
+    double score(const vector<int> &parent, const vector<int> &left, const vector<int> &right)
+    {
+        return (this->*evaluate)(parent, left, right);
+    }
+
+    double IG(const vector<int> &parent, const vector<int> &left, const vector<int> &right)
+    {
+        int left_size = accumulate(left.begin(), left.end(), 0);
+        int right_size = accumulate(right.begin(), right.end(), 0);
+        int size = left_size + right_size;
+        if (left_size == 0 || right_size == 0)
+            return 0.0;
+
+        double parent_entropy = entropy(parent, size);
+        double left_entropy = entropy(left, left_size);
+        double right_entropy = entropy(right, right_size);
+
+        double weighted_avg = static_cast<double>(left_size) / size * left_entropy +
+                              static_cast<double>(right_size) / size * right_entropy;
+
+        return parent_entropy - weighted_avg;
+    }
+
+    // Gain ratio: the gain divided by the split information -sum(p log2 p).
+    double IGR(const vector<int> &parent, const vector<int> &left, const vector<int> &right)
+    {
+        int left_size = accumulate(left.begin(), left.end(), 0);
+        int right_size = accumulate(right.begin(), right.end(), 0);
+        int size = left_size + right_size;
+        if (left_size == 0 || right_size == 0)
+            return 0.0;
+
+        double parent_entropy = entropy(parent, size);
+        double left_entropy = entropy(left, left_size);
+        double right_entropy = entropy(right, right_size);
+
+        double weighted_avg = static_cast<double>(left_size) / size * left_entropy +
+                              static_cast<double>(right_size) / size * right_entropy;
+        double IV = -(static_cast<double>(left_size) / size * log2(static_cast<double>(left_size) / size) +
+                      static_cast<double>(right_size) / size * log2(static_cast<double>(right_size) / size));
+
+        return (parent_entropy - weighted_avg) / IV;
+    }
+
+    double NWIG(const vector<int> &parent, const vector<int> &left, const vector<int> &right)
+    {
+        int left_size = accumulate(left.begin(), left.end(), 0);
+        int right_size = accumulate(right.begin(), right.end(), 0);
+        int size = left_size + right_size;
+        if (left_size == 0 || right_size == 0)
+            return 0.0;
+
+        double parent_entropy = entropy(parent, size);
+        double left_entropy = entropy(left, left_size);
+        double right_entropy = entropy(right, right_size);
+
+        double weighted_avg = static_cast<double>(left_size) / size * left_entropy +
+                              static_cast<double>(right_size) / size * right_entropy;
+
+        return ((parent_entropy - weighted_avg) / (log2(3))) * (1 - 1 / static_cast<double>(size));
+    }
+
+    double entropy(const vector<int> &class_count, int size)
+    {
+        double ent = 0.0;
+        for (int count : class_count)
+        {
+            if (count == 0)
+                continue;
+            double p = static_cast<double>(count) / size;
+            ent -= p * log2(p);
+        }
+        return ent;
+    }
+
+    node *leaf(const Dataset &data, const int *begin, const int *end)
+    {
+        int label = majority_class(data, begin, end);
+        return new node(-1, 0.0, 0.0, data.classes[label], label);
+    }
+
+    int majority_class(const Dataset &data, const int *begin, const int *end)
+    {
+        vector<int> class_count(data.num_classes(), 0);
+        for (const int *row = begin; row != end; row++)
+            class_count[data.labels[*row]] += weights ? (*weights)[*row] : 1;
+        int majority_class = 0;
+        for (int i = 1; i < data.num_classes(); i++)
+            if (class_count[i] > class_count[majority_class])
+                majority_class = i;
+        return majority_class;
+    }
+
+    double accuracy(vector<vector<string>> &data)
+    {
+        int features = mappers.size();
+        vector<float> encoded((size_t)data.size() * features);
+        for (size_t r = 0; r < data.size(); r++)
+            encode(data[r], encoded.data() + r * features);
+        vector<int> labels = predict_labels(encoded.data(), data.size());
+        int correct_predictions = 0;
+        for (size_t r = 0; r < data.size(); r++)
+        {
+            if (!flat.empty() && classes[labels[r]] == data[r].back())
+                correct_predictions++;
+        }
+        return static_cast<double>(correct_predictions) / data.size();
+    }
+
+    double accuracy(const Table &table, const vector<int> &rows)
+    {
+        int features = table.features();
+        vector<float> encoded((size_t)rows.size() * features);
+        for (size_t r = 0; r < rows.size(); r++)
+            table.encode(rows[r], encoded.data() + r * features);
+        vector<int> labels = predict_labels(encoded.data(), rows.size());
+        int correct_predictions = 0;
+        for (size_t r = 0; r < rows.size(); r++)
+        {
+            if (labels[r] == table.columns.back().codes[rows[r]])
+                correct_predictions++;
+        }
+        return static_cast<double>(correct_predictions) / rows.size();
+    }
+
+    // The features of a raw row as the tree compares them: categorical
+    // values through the mappers (unknown ones as 0), the rest parsed.
+    void encode(const vector<string> &row, float *out)
+    {
+        for (int i = 0; i < (int)mappers.size(); i++)
+        {
+            if (is_string(row[i]))
+            {
+                auto found = mappers[i].find(row[i]);
+                out[i] = found != mappers[i].end() ? found->second : 0;
+            }
+            else
+                out[i] = stod(row[i]);
+        }
+    }
+
+    // Class index of the leaf an encoded row ends in.
+    int classify(const float *row) const
+    {
+        return flat.classify(row);
+    }
+
+    // Class indices for `count` encoded rows stored one after another.
+    vector<int> predict_labels(const float *rows, int count) const
+    {
+        vector<int> labels(count);
+        flat.predict(rows, count, labels.data());
+        return labels;
+    }
+
+    string predict(const vector<string> &row)
+    {
+        if (flat.empty())
+            return "";
+        vector<float> encoded(mappers.size());
+        encode(row, encoded.data());
+        return classes[classify(encoded.data())];
+    }
+
+    Dataset preprocessor(vector<vector<string>> &data, vector<string> &headers)
+    {
+        Dataset dataset;
+        int features = headers.size() - 1;
+        map<string, int> class_index;
+        for (const auto &row : data)
+            class_index[row.back()] = 0;
+        for (auto &entry : class_index)
+        {
+            entry.second = dataset.classes.size();
+            dataset.classes.push_back(entry.first);
+        }
+
+        dataset.columns.assign(features, vector<float>(data.size()));
+        dataset.labels.resize(data.size());
+        dataset.categorical.assign(features, 0);
+        for (int i = 0; i < features; i++)
+            dataset.categorical[i] = isCategorical[i] && native_categorical;
+        for (int r = 0; r < data.size(); r++)
+        {
+            const vector<string> &row = data[r];
+            for (int i = 0; i < features; i++)
+            {
+                if (is_string(row[i]))
+                {
+                    if (mappers[i].find(row[i]) == mappers[i].end())
+                        mappers[i][row[i]] = mappers[i].size() + 1;
+                    dataset.columns[i][r] = mappers[i][row[i]];
+                }
+                else
+                    dataset.columns[i][r] = stod(row[i]);
+            }
+            dataset.labels[r] = class_index[row.back()];
+        }
+        return dataset;
+    }
+
+    pair<vector<vector<string>>, vector<vector<string>>> divide(vector<vector<string>> &data, double test_data_ratio = 0.2)
+    {
+        vector<vector<string>> training_data, testing_data;
+        int test_size = data.size() * test_data_ratio;
+
+        vector<int> indices(data.size());
+        iota(indices.begin(), indices.end(), 0);
+
+        random_device rd;
+        mt19937 g(rd());
+        shuffle(indices.begin(), indices.end(), g);
+
+        for (int i = 0; i < data.size(); i++)
+        {
+            if (i < test_size)
+                testing_data.push_back(data[indices[i]]);
+            else
+                training_data.push_back(data[indices[i]]);
+        }
+        return {training_data, testing_data};
+    }
+
+    // Splits row indices the same way.
+    pair<vector<int>, vector<int>> divide(const vector<int> &rows, double test_data_ratio = 0.2)
+    {
+        vector<int> training_rows, testing_rows;
+        int test_size = rows.size() * test_data_ratio;
+
+        vector<int> indices(rows.size());
+        iota(indices.begin(), indices.end(), 0);
+
+        random_device rd;
+        mt19937 g(rd());
+        shuffle(indices.begin(), indices.end(), g);
+
+        for (int i = 0; i < (int)rows.size(); i++)
+        {
+            if (i < test_size)
+                testing_rows.push_back(rows[indices[i]]);
+            else
+                training_rows.push_back(rows[indices[i]]);
+        }
+        return {training_rows, testing_rows};
+    }
+
+    void mappers_init(vector<vector<string>> &data, vector<string> &headers)
+    {
+        mappers.clear();
+        for (int i = 0; i < headers.size() - 1; i++)
+        {
+            map<string, int> mapper;
+            set<string> unique_values;
+            for (const auto &row : data)
+                unique_values.insert(row[i]);
+            int index = 0;
+            if (is_string(*unique_values.begin()))
+            {
+                isCategorical[i] = true;
+                for (const auto &value : unique_values)
+                    mapper[value] = index++;
+            }
+            mappers.push_back(mapper);
+        }
+    }
+
+    bool is_numeric(const string &str)
+    {
+        if (str.empty())
+            return false;
+
+        // strtod instead of stod: a thrown exception per categorical cell
+        // cost more than the whole tree build
+        char *end;
+        strtod(str.c_str(), &end);
+        return end != str.c_str() && end == str.c_str() + str.length();
+    }
+
+    bool is_string(const string &str)
+    {
+        return !is_numeric(str);
+    }
+
+    void print_simple_tree(node *root, const vector<string> &headers, int depth = 0)
+    {
+        if (root == nullptr)
+            return;
+
+        string indent(depth * 4, '\t');
+
+        if (root->feature_index == -1)
+        {
+            cout << indent << "PREDICT: " << root->value << endl;
+            return;
+        }
+
+        if (root->categories.empty())
+            cout << indent << "IF " << headers[root->feature_index]
+                 << " <= " << root->threshold << " THEN:" << endl;
+        else
+        {
+            cout << indent << "IF " << headers[root->feature_index] << " IN {";
+            bool first = true;
+            for (const auto &entry : mappers[root->feature_index])
+                if (in_category_set(root->categories.data(), root->categories.size(), entry.second))
+                {
+                    cout << (first ? "" : ", ") << entry.first;
+                    first = false;
+                }
+            cout << "} THEN:" << endl;
+        }
+        print_simple_tree(root->left, headers, depth + 1);
+
+        cout << indent << "ELSE:" << endl;
+        print_simple_tree(root->right, headers, depth + 1);
+    }
+
+    void print_tree(const vector<string> &headers)
+    {
+        cout << "\n=== DECISION TREE ===" << endl;
+        print_simple_tree(root, headers);
+        cout << "===================" << endl;
+    }
+
+    void delete_tree(node *n)
+    {
+        if (n != nullptr)
+        {
+            delete_tree(n->left);
+            delete_tree(n->right);
+            delete n;
+        }
+    }
+
+    ~Tree()
+    {
+        delete_tree(root);
+    }
+};
+
+#endif